@@ -31,14 +31,60 @@ SOURCES += \
     types.cpp \
     implicit_diff_scheme_cyl.cpp \
     plotter.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    tridiag_solver.cpp \
+    decim_pyramid.cpp \
+    results_loader.cpp \
+    mapped_series.cpp \
+    compare_plotter.cpp \
+    heat_case.cpp \
+    param_estimator.cpp \
+    sensitivity.cpp \
+    uncertainty.cpp \
+    result_cache.cpp \
+    env_model.cpp \
+    radial_layers.cpp \
+    adi_rz.cpp \
+    adi_rphi.cpp \
+    parareal.cpp \
+    alpha_table.cpp \
+    ambient_stream.cpp \
+    events.cpp \
+    surrogate.cpp \
+    process_batch.cpp \
+    worker_pool.cpp
 
 HEADERS += \
     types.h \
     implicit_diff_scheme_cyl.h \
     plotter.h \
     err.h \
-    mainwindow.h
+    spsc_queue.h \
+    mainwindow.h \
+    tridiag_solver.h \
+    decim_pyramid.h \
+    results_loader.h \
+    mapped_series.h \
+    compare_plotter.h \
+    heat_case.h \
+    param_estimator.h \
+    dual.h \
+    sensitivity.h \
+    uncertainty.h \
+    result_cache.h \
+    env_model.h \
+    radial_layers.h \
+    parallel_lines.h \
+    adi_rz.h \
+    adi_rphi.h \
+    parareal.h \
+    alpha_table.h \
+    ambient_stream.h \
+    events.h \
+    surrogate.h \
+    process_batch.h \
+    worker_pool.h \
+    scheme_coeffs.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,332 @@
+#include "adi_rphi.h"
+#include "parallel_lines.h"
+#include "tridiag_solver.h"
+
+#include <fstream>
+#include <thread>
+#include <math.h>
+
+
+using namespace std;
+
+
+AdiSolverRPhi::AdiSolverRPhi() :
+  env(nullptr), nr(0), np(0), dphi(0.0),
+  time(0.0), timeMax(1e+10), threadsN(0),
+  is_walls(false), is_startConds(false), is_bounds(false)
+{}
+
+
+AdiSolverRPhi::~AdiSolverRPhi()
+{
+  for (size_t t = 0; t < scratch.size(); ++t)
+    gsl_interp_accel_free(scratch[t].acc);
+  delete env;
+}
+
+
+void AdiSolverRPhi::setWalls(const Walls &ws)
+{
+  layers.set(ws);
+  nr = layers.size();
+  if (nr < 3)
+    throw err.sendEx("radial grid must have 3 nodes at least");
+  is_walls = true;
+  is_startConds = false;
+}
+
+
+void AdiSolverRPhi::setStartConds(const StartConds &sc, size_t n_phi)
+{
+  // n_phi - angular segments of the half circle
+
+  if (!is_walls)
+    throw err.sendEx("walls are not initialized");
+  if (n_phi < 2)
+    throw err.sendEx("angular grid must have 2 segments at least");
+
+  np = n_phi + 1;
+  dphi = M_PI / n_phi;
+  horizCylNuShape(n_phi, nuShape);
+  time = sc.time;
+  theta.assign(nr * np, sc.T0);
+
+  time_vec.clear();
+  Tw_vec.clear();
+  TwMin_vec.clear();
+  TwMax_vec.clear();
+  time_vec.push_back(time);
+  pushSurface();
+  is_startConds = true;
+}
+
+
+void AdiSolverRPhi::setBounds(const BoundCond &inner, const BoundCond &outer)
+{
+  if (inner.type < 1 || inner.type > 3)
+    throw err.sendEx("this condition type is not supported for the first bound");
+  if (outer.type < 1 || outer.type > 4)
+    throw err.sendEx("this condition type is not supported for the second bound");
+  bInner = inner;
+  bOuter = outer;
+  is_bounds = true;
+}
+
+
+void AdiSolverRPhi::setEnvironment(double t_amb_C, const string &src_path)
+{
+  EnvModel *e = new EnvModel(t_amb_C, src_path);
+  delete env;
+  env = e;
+}
+
+
+void AdiSolverRPhi::setThreads(size_t n)
+{
+  // 0 - all the cores
+  threadsN = n;
+}
+
+
+void AdiSolverRPhi::setMaxTime(double t_max)
+{
+  if (t_max < 0.0)
+    throw err.sendEx("time limit must be > 0");
+  timeMax = t_max;
+}
+
+
+void AdiSolverRPhi::prepareScratch()
+{
+  // Scratch memory and the pool's threads (created once)
+
+  size_t tn = threadsN;
+  if (tn == 0)
+    tn = thread::hardware_concurrency();
+  if (tn == 0)
+    tn = 1;
+
+  size_t n = (nr > np) ? nr : np;
+  for (size_t t = scratch.size(); t < tn; ++t)
+  {
+    scratch.push_back(LineScratch());
+    scratch.back().acc = gsl_interp_accel_alloc();
+  }
+  for (size_t t = 0; t < tn; ++t)
+    scratch[t].resize(n);
+  pool.resize(tn);
+}
+
+
+void AdiSolverRPhi::solve(double dt, double delta_T)
+{
+  /*
+   * Steps until the mean outer surface temperature falls
+   * to Ta + delta_T (or the time limit).
+  */
+
+  if (!env)
+    throw err.sendEx("environment is not initialized");
+  if (!is_walls)
+    throw err.sendEx("walls are not initialized");
+  if (!is_bounds)
+    throw err.sendEx("boundary conditions are not initialized");
+  if (!is_startConds)
+    throw err.sendEx("start conditions are not initialized");
+  if (layers.coords()[0] < EPS && (bInner.type != 2 || fabs(bInner.q) > EPS))
+    throw err.sendEx("the axis of the cylinder must have q = 0 (type 2)");
+  if (delta_T < 0.0)
+    throw err.sendEx("temperature is set less than ambient temperature");
+  if (dt < 0.0)
+    throw err.sendEx("time step must be > 0");
+
+  prepareScratch();
+  double T_end = env->getTa() + delta_T;
+
+  while (Tw_vec.back() > T_end && time < timeMax)
+  {
+    runLines(pool, np, nr, ADI_PHI_MIN_WORK, [this, dt](size_t k1, size_t k2, size_t t)
+    {
+      sweepRadial(dt, k1, k2, scratch[t]);
+    });
+    averageAxis();
+    runLines(pool, nr, np, ADI_PHI_MIN_WORK, [this, dt](size_t i1, size_t i2, size_t t)
+    {
+      sweepAngular(dt, i1, i2, scratch[t]);
+    });
+
+    time += dt;
+    time_vec.push_back(time);
+    pushSurface();
+  }
+}
+
+
+void AdiSolverRPhi::sweepRadial(double dt, size_t k1, size_t k2, LineScratch &s)
+{
+  // Rows are the same as the radial scheme's ones, but the outer
+  // natural convection is local
+
+  ThomasSolver ts;
+  size_t n = nr - 1;
+  double D = 2.0 * layers.rOut();
+  double rw[3];
+
+  for (size_t k = k1; k < k2; ++k)
+  {
+    double *th = &theta[k * nr];
+
+    double al = (bInner.type == 3 && bInner.alpha < EPS) ?
+                  env->alphaConv(th[0], D, s.acc) : 0.0;
+    layers.boundRow(bInner, th[0], layers.boundKH(false, th, s.acc), al, *env, rw);
+    s.lo[0] = 0.0;
+    s.di[0] = rw[0];
+    s.up[0] = rw[1];
+    s.f[0] = rw[2];
+
+    for (size_t i = 1; i < n; ++i)
+    {
+      double A, B;
+      layers.radialCoeffs(i, th, dt, s.acc, A, B);
+      s.lo[i] = -B;
+      s.di[i] = 1.0 + A + B;
+      s.up[i] = -A;
+      s.f[i] = th[i];
+    }
+
+    al = (bOuter.type == 3 && bOuter.alpha < EPS) ?
+           env->alphaConv(th[n], D, s.acc) * nuShape[k] : 0.0;
+    layers.boundRow(bOuter, th[n], layers.boundKH(true, th, s.acc), al, *env, rw);
+    s.lo[n] = rw[1];
+    s.di[n] = rw[0];
+    s.up[n] = 0.0;
+    s.f[n] = rw[2];
+
+    ts.solve(s.lo.data(), s.di.data(), s.up.data(), s.f.data(), s.x.data(), nr);
+    for (size_t i = 0; i < nr; ++i)
+      th[i] = s.x[i];
+  }
+}
+
+
+void AdiSolverRPhi::averageAxis()
+{
+  // The axis node is common for all the sectors (trapezoidal mean)
+
+  if (layers.coords()[0] >= EPS)
+    return;
+
+  double sum = 0.0;
+  for (size_t k = 0; k < np; ++k)
+    sum += (k == 0 || k == np - 1) ? 0.5 * theta[k * nr] : theta[k * nr];
+  sum /= np - 1;
+  for (size_t k = 0; k < np; ++k)
+    theta[k * nr] = sum;
+}
+
+
+void AdiSolverRPhi::sweepAngular(double dt, size_t i1, size_t i2, LineScratch &s)
+{
+  /*
+   * Ends (bottom and top) are the symmetry planes: the ghost node
+   * theta[-1] = theta[1] gives (1 + 2A) * theta[0] - 2A * theta[1].
+  */
+
+  ThomasSolver ts;
+  const vector<double> &r = layers.coords();
+  size_t n = np - 1;
+  double *th = s.line.data();
+
+  for (size_t i = i1; i < i2; ++i)
+  {
+    if (r[i] < EPS)
+      continue;
+
+    for (size_t k = 0; k < np; ++k)
+      th[k] = theta[k * nr + i];
+
+    double h = r[i] * dphi;
+    for (size_t k = 0; k <= n; ++k)
+    {
+      double c = dt / (layers.cRhoNode(i, th[k], s.acc) * h * h);
+      size_t kp = (k == n) ? n - 1 : k + 1;
+      size_t km = (k == 0) ? 1 : k - 1;
+      double A = layers.lamNode(i, 0.5 * (th[k] + th[kp]), s.acc) * c;
+      double B = layers.lamNode(i, 0.5 * (th[km] + th[k]), s.acc) * c;
+      s.di[k] = 1.0 + A + B;
+      s.lo[k] = (k == n) ? -(A + B) : -B;
+      s.up[k] = (k == 0) ? -(A + B) : -A;
+      s.f[k] = th[k];
+    }
+
+    ts.solve(s.lo.data(), s.di.data(), s.up.data(), s.f.data(), s.x.data(), np);
+    for (size_t k = 0; k < np; ++k)
+      theta[k * nr + i] = s.x[k];
+  }
+}
+
+
+void AdiSolverRPhi::pushSurface()
+{
+  double sum = 0.0;
+  double T_min = theta[nr - 1];
+  double T_max = T_min;
+  for (size_t k = 0; k < np; ++k)
+  {
+    double T = theta[k * nr + nr - 1];
+    sum += (k == 0 || k == np - 1) ? 0.5 * T : T;
+    if (T < T_min)
+      T_min = T;
+    if (T > T_max)
+      T_max = T;
+  }
+  Tw_vec.push_back(sum / (np - 1));
+  TwMin_vec.push_back(T_min);
+  TwMax_vec.push_back(T_max);
+}
+
+
+void AdiSolverRPhi::getSurface(vector<double> &phi_deg, vector<double> &T_C) const
+{
+  // Current outer surface temperature from the bottom (0) to the top (180)
+
+  phi_deg.resize(np);
+  T_C.resize(np);
+  for (size_t k = 0; k < np; ++k)
+  {
+    phi_deg[k] = k * dphi * 180.0 / M_PI;
+    T_C[k] = theta[k * nr + nr - 1] - T_ABS;
+  }
+}
+
+
+void AdiSolverRPhi::writeResultsFile(const string &path) const
+{
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("resulting file is not opened");
+
+  f << "t, sec\tT, C\tT_min, C\tT_max, C\n";
+  for (size_t i = 0; i < Tw_vec.size(); ++i)
+    f << time_vec[i] << '\t' << Tw_vec[i] - T_ABS << '\t'
+      << TwMin_vec[i] - T_ABS << '\t' << TwMax_vec[i] - T_ABS << '\n';
+  f.close();
+}
+
+
+void AdiSolverRPhi::writeFieldFile(const string &path) const
+{
+  // Current field: r, phi (from the bottom), T in C
+
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("field file is not opened");
+
+  const vector<double> &r = layers.coords();
+  f << "r, m\tphi, deg\tT, C\n";
+  for (size_t k = 0; k < np; ++k)
+    for (size_t i = 0; i < nr; ++i)
+      f << r[i] << '\t' << k * dphi * 180.0 / M_PI << '\t'
+        << theta[k * nr + i] - T_ABS << '\n';
+  f.close();
+}
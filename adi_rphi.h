@@ -0,0 +1,90 @@
+#ifndef ADI_RPHI_H
+#define ADI_RPHI_H
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "env_model.h"
+#include "radial_layers.h"
+#include "worker_pool.h"
+
+// Nodes of a sweep to split it over threads (a node costs ~64 ns,
+// measured on the 300 x 50 grid; see ADI_MIN_WORK)
+#define ADI_PHI_MIN_WORK 2500
+
+
+/*
+ * Circumferentially resolved (r, phi) heat conduction of the long
+ * horizontal cylinder. The outer surface has the local natural convection
+ * (mean correlation of horizCylNu times horizCylNuShape) and the radiation
+ * of its own temperature, so the bottom cools faster than the top.
+ * The cylinder is symmetric about the vertical plane, so the half
+ * phi in [0; pi] (0 - bottom) is solved with the symmetry at its ends.
+ * Every step is split in the directions: the radial sweep on every sector,
+ * then the angular sweep on every radius (the lines of a sweep are solved
+ * in parallel). Radial rows are the same as ImplicitDiffSchemeCyl's.
+*/
+class AdiSolverRPhi
+{
+private:
+  mutable Error err;
+
+  RadialLayers layers;
+  EnvModel *env;
+  BoundCond bInner, bOuter;
+
+  size_t nr, np;                  // Nodes of the radial and angular lines
+  double dphi;
+  double time, timeMax;
+  std::vector<double> theta;      // [k * nr + i]: k - angular, i - radial node
+  std::vector<double> nuShape;    // Local / mean Nusselt number of the angles
+  std::vector<double> time_vec;
+  std::vector<double> Tw_vec;     // Outer surface: mean over the circumference
+  std::vector<double> TwMin_vec;
+  std::vector<double> TwMax_vec;
+  size_t threadsN;
+  std::vector<LineScratch> scratch;
+  WorkerPool pool;                // Threads of the sweeps
+
+  bool is_walls;
+  bool is_startConds;
+  bool is_bounds;
+
+public:
+  AdiSolverRPhi();
+  ~AdiSolverRPhi();
+
+  AdiSolverRPhi(const AdiSolverRPhi&) = delete;
+  AdiSolverRPhi& operator=(const AdiSolverRPhi&) = delete;
+
+  void setWalls(const Walls &ws);
+  void setStartConds(const StartConds &sc, size_t n_phi);
+  void setBounds(const BoundCond &inner, const BoundCond &outer);
+  void setEnvironment(double t_amb_C, const std::string &src_path);
+  void setThreads(size_t n);
+  void setMaxTime(double t_max);
+
+  void solve(double dt, double delta_T);
+
+  const std::vector<double>& getTime() const { return time_vec; }
+  const std::vector<double>& getTw() const { return Tw_vec; }
+  const std::vector<double>& getTwMin() const { return TwMin_vec; }
+  const std::vector<double>& getTwMax() const { return TwMax_vec; }
+  const std::vector<double>& getTheta() const { return theta; }
+  size_t getNr() const { return nr; }
+  size_t getNphi() const { return np; }
+  void getSurface(std::vector<double> &phi_deg, std::vector<double> &T_C) const;
+  void writeResultsFile(const std::string &path) const;
+  void writeFieldFile(const std::string &path) const;
+
+private:
+  void prepareScratch();
+  void sweepRadial(double dt, size_t k1, size_t k2, LineScratch &s);
+  void sweepAngular(double dt, size_t i1, size_t i2, LineScratch &s);
+  void averageAxis();
+  void pushSurface();
+};
+
+
+#endif // ADI_RPHI_H
@@ -0,0 +1,314 @@
+#include "adi_rz.h"
+#include "parallel_lines.h"
+#include "tridiag_solver.h"
+
+#include <fstream>
+#include <thread>
+#include <math.h>
+
+
+using namespace std;
+
+
+AdiSolverRZ::AdiSolverRZ() :
+  env(nullptr), nr(0), nz(0), H(0.0), dz(0.0),
+  time(0.0), timeMax(1e+10), threadsN(0),
+  is_walls(false), is_startConds(false), is_bounds(false), is_endBounds(false)
+{}
+
+
+AdiSolverRZ::~AdiSolverRZ()
+{
+  for (size_t t = 0; t < scratch.size(); ++t)
+    gsl_interp_accel_free(scratch[t].acc);
+  delete env;
+}
+
+
+void AdiSolverRZ::setWalls(const Walls &ws)
+{
+  layers.set(ws);
+  nr = layers.size();
+  if (nr < 3)
+    throw err.sendEx("radial grid must have 3 nodes at least");
+  is_walls = true;
+  is_startConds = false;
+}
+
+
+void AdiSolverRZ::setStartConds(const StartConds &sc, size_t n_z)
+{
+  // Height is sc.H (see StartConds::setGeometry), n_z - axial segments
+
+  if (!is_walls)
+    throw err.sendEx("walls are not initialized");
+  if (sc.H < EPS)
+    throw err.sendEx("height of the cylinder is not set");
+  if (n_z < 2)
+    throw err.sendEx("axial grid must have 2 segments at least");
+
+  H = sc.H;
+  nz = n_z + 1;
+  dz = H / n_z;
+  time = sc.time;
+  theta.assign(nr * nz, sc.T0);
+
+  time_vec.clear();
+  Tw_vec.clear();
+  time_vec.push_back(time);
+  Tw_vec.push_back(sc.T0);
+  is_startConds = true;
+}
+
+
+void AdiSolverRZ::checkBound(const BoundCond &bc) const
+{
+  if (bc.type < 1 || bc.type > 4)
+    throw err.sendEx("this condition type is not supported");
+}
+
+
+void AdiSolverRZ::setRadialBounds(const BoundCond &inner, const BoundCond &outer)
+{
+  checkBound(inner);
+  checkBound(outer);
+  if (inner.type == 4)
+    throw err.sendEx("this condition type is not supported for the first bound");
+  bInner = inner;
+  bOuter = outer;
+  is_bounds = true;
+}
+
+
+void AdiSolverRZ::setEndBounds(const BoundCond &bottom, const BoundCond &top)
+{
+  // Insulated ends (type 2, q = 0) reduce the solution to the radial one
+
+  checkBound(bottom);
+  checkBound(top);
+  bBottom = bottom;
+  bTop = top;
+  is_endBounds = true;
+}
+
+
+void AdiSolverRZ::setEnvironment(double t_amb_C, const string &src_path)
+{
+  EnvModel *e = new EnvModel(t_amb_C, src_path);
+  delete env;
+  env = e;
+}
+
+
+void AdiSolverRZ::setThreads(size_t n)
+{
+  // 0 - all the cores
+  threadsN = n;
+}
+
+
+void AdiSolverRZ::setMaxTime(double t_max)
+{
+  if (t_max < 0.0)
+    throw err.sendEx("time limit must be > 0");
+  timeMax = t_max;
+}
+
+
+void AdiSolverRZ::prepareScratch()
+{
+  // Scratch memory and the pool's threads (created once)
+
+  size_t tn = threadsN;
+  if (tn == 0)
+    tn = thread::hardware_concurrency();
+  if (tn == 0)
+    tn = 1;
+
+  size_t n = (nr > nz) ? nr : nz;
+  for (size_t t = scratch.size(); t < tn; ++t)
+  {
+    scratch.push_back(LineScratch());
+    scratch.back().acc = gsl_interp_accel_alloc();
+  }
+  for (size_t t = 0; t < tn; ++t)
+    scratch[t].resize(n);
+  pool.resize(tn);
+}
+
+
+void AdiSolverRZ::solve(double dt, double delta_T)
+{
+  /*
+   * Steps until the outer surface at the mid-height falls
+   * to Ta + delta_T (or the time limit).
+  */
+
+  if (!env)
+    throw err.sendEx("environment is not initialized");
+  if (!is_walls)
+    throw err.sendEx("walls are not initialized");
+  if (!is_bounds)
+    throw err.sendEx("radial boundary conditions are not initialized");
+  if (!is_endBounds)
+    throw err.sendEx("end boundary conditions are not initialized");
+  if (!is_startConds)
+    throw err.sendEx("start conditions are not initialized");
+  if (layers.coords()[0] < EPS && (bInner.type != 2 || fabs(bInner.q) > EPS))
+    throw err.sendEx("the axis of the cylinder must have q = 0 (type 2)");
+  if (delta_T < 0.0)
+    throw err.sendEx("temperature is set less than ambient temperature");
+  if (dt < 0.0)
+    throw err.sendEx("time step must be > 0");
+
+  prepareScratch();
+  size_t iw = (nz / 2) * nr + nr - 1;
+  double T_end = env->getTa() + delta_T;
+
+  while (Tw_vec.back() > T_end && time < timeMax)
+  {
+    runLines(pool, nz, nr, ADI_MIN_WORK, [this, dt](size_t j1, size_t j2, size_t t)
+    {
+      sweepRadial(dt, j1, j2, scratch[t]);
+    });
+    runLines(pool, nr, nz, ADI_MIN_WORK, [this, dt](size_t i1, size_t i2, size_t t)
+    {
+      sweepAxial(dt, i1, i2, scratch[t]);
+    });
+
+    time += dt;
+    time_vec.push_back(time);
+    Tw_vec.push_back(theta[iw]);
+  }
+}
+
+
+void AdiSolverRZ::sweepRadial(double dt, size_t j1, size_t j2, LineScratch &s)
+{
+  // Rows are the same as the radial scheme's ones
+
+  ThomasSolver ts;
+  size_t n = nr - 1;
+  double D = 2.0 * layers.rOut();
+  double rw[3];
+
+  for (size_t j = j1; j < j2; ++j)
+  {
+    double *th = &theta[j * nr];
+
+    double al = (bInner.type == 3 && bInner.alpha < EPS) ?
+                  env->alphaConv(th[0], D, s.acc) : 0.0;
+    layers.boundRow(bInner, th[0], layers.boundKH(false, th, s.acc), al, *env, rw);
+    s.lo[0] = 0.0;
+    s.di[0] = rw[0];
+    s.up[0] = rw[1];
+    s.f[0] = rw[2];
+
+    for (size_t i = 1; i < n; ++i)
+    {
+      double A, B;
+      layers.radialCoeffs(i, th, dt, s.acc, A, B);
+      s.lo[i] = -B;
+      s.di[i] = 1.0 + A + B;
+      s.up[i] = -A;
+      s.f[i] = th[i];
+    }
+
+    al = (bOuter.type == 3 && bOuter.alpha < EPS) ?
+           env->alphaConv(th[n], D, s.acc) : 0.0;
+    layers.boundRow(bOuter, th[n], layers.boundKH(true, th, s.acc), al, *env, rw);
+    s.lo[n] = rw[1];
+    s.di[n] = rw[0];
+    s.up[n] = 0.0;
+    s.f[n] = rw[2];
+
+    ts.solve(s.lo.data(), s.di.data(), s.up.data(), s.f.data(), s.x.data(), nr);
+    for (size_t i = 0; i < nr; ++i)
+      th[i] = s.x[i];
+  }
+}
+
+
+void AdiSolverRZ::sweepAxial(double dt, size_t i1, size_t i2, LineScratch &s)
+{
+  // Column of the node i is gathered to the contiguous line
+
+  ThomasSolver ts;
+  size_t n = nz - 1;
+  double *th = s.line.data();
+  double rw[3];
+
+  for (size_t i = i1; i < i2; ++i)
+  {
+    for (size_t j = 0; j < nz; ++j)
+      th[j] = theta[j * nr + i];
+
+    endRow(bBottom, i, th[0], s.acc, rw);
+    s.lo[0] = 0.0;
+    s.di[0] = rw[0];
+    s.up[0] = rw[1];
+    s.f[0] = rw[2];
+
+    for (size_t j = 1; j < n; ++j)
+    {
+      double k = dt / (layers.cRhoNode(i, th[j], s.acc) * dz * dz);
+      double A = layers.lamNode(i, 0.5 * (th[j] + th[j + 1]), s.acc) * k;
+      double B = layers.lamNode(i, 0.5 * (th[j - 1] + th[j]), s.acc) * k;
+      s.lo[j] = -B;
+      s.di[j] = 1.0 + A + B;
+      s.up[j] = -A;
+      s.f[j] = th[j];
+    }
+
+    endRow(bTop, i, th[n], s.acc, rw);
+    s.lo[n] = rw[1];
+    s.di[n] = rw[0];
+    s.up[n] = 0.0;
+    s.f[n] = rw[2];
+
+    ts.solve(s.lo.data(), s.di.data(), s.up.data(), s.f.data(), s.x.data(), nz);
+    for (size_t j = 0; j < nz; ++j)
+      theta[j * nr + i] = s.x[j];
+  }
+}
+
+
+void AdiSolverRZ::endRow(const BoundCond &bc, size_t i, double th,
+                         gsl_interp_accel *acc, double *rw) const
+{
+  // End faces use the cylinder's natural convection correlation too
+
+  double al = (bc.type == 3 && bc.alpha < EPS) ?
+                env->alphaConv(th, 2.0 * layers.rOut(), acc) : 0.0;
+  layers.boundRow(bc, th, layers.lamNode(i, th, acc) / dz, al, *env, rw);
+}
+
+
+void AdiSolverRZ::writeResultsFile(const string &path) const
+{
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("resulting file is not opened");
+
+  f << "t, sec\tT, C\n";
+  for (size_t i = 0; i < Tw_vec.size(); ++i)
+    f << time_vec[i] << '\t' << Tw_vec[i] - T_ABS << '\n';
+  f.close();
+}
+
+
+void AdiSolverRZ::writeFieldFile(const string &path) const
+{
+  // Current field: r, z, T in C
+
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("field file is not opened");
+
+  const vector<double> &r = layers.coords();
+  f << "r, m\tz, m\tT, C\n";
+  for (size_t j = 0; j < nz; ++j)
+    for (size_t i = 0; i < nr; ++i)
+      f << r[i] << '\t' << j * dz << '\t' << theta[j * nr + i] - T_ABS << '\n';
+  f.close();
+}
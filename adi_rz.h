@@ -0,0 +1,90 @@
+#ifndef ADI_RZ_H
+#define ADI_RZ_H
+
+#include <gsl/gsl_interp.h>
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "env_model.h"
+#include "radial_layers.h"
+#include "worker_pool.h"
+
+// Nodes of a sweep to split it over threads: a node of a line costs
+// ~65 ns (lookups and Thomas), a section of the pool ~6-8 us (measured),
+// so the split is worth it from ~20 sections' cost of the serial work
+#define ADI_MIN_WORK 2500
+
+
+/*
+ * Axisymmetric (r, z) heat conduction of the finite cylinder.
+ * Every time step is split in the directions (locally one-dimensional
+ * implicit scheme): the radial sweep on every z-line, then the axial sweep
+ * on every radial node. The lines of a sweep are independent tridiagonal
+ * systems, so they are spread over the threads.
+ * Radial coefficients and bounds are the same as ImplicitDiffSchemeCyl's;
+ * the end faces have their own bound conditions.
+*/
+class AdiSolverRZ
+{
+private:
+  mutable Error err;
+
+  RadialLayers layers;
+  EnvModel *env;
+  BoundCond bInner, bOuter;       // Radial bounds
+  BoundCond bBottom, bTop;        // End faces
+
+  size_t nr, nz;                  // Nodes of the radial and axial lines
+  double H, dz;
+  double time, timeMax;
+  std::vector<double> theta;      // [j * nr + i]: j - axial, i - radial node
+  std::vector<double> time_vec;
+  std::vector<double> Tw_vec;     // Outer surface at the mid-height
+  size_t threadsN;
+
+  std::vector<LineScratch> scratch;
+  WorkerPool pool;                // Threads of the sweeps
+
+  bool is_walls;
+  bool is_startConds;
+  bool is_bounds;
+  bool is_endBounds;
+
+public:
+  AdiSolverRZ();
+  ~AdiSolverRZ();
+
+  AdiSolverRZ(const AdiSolverRZ&) = delete;
+  AdiSolverRZ& operator=(const AdiSolverRZ&) = delete;
+
+  void setWalls(const Walls &ws);
+  void setStartConds(const StartConds &sc, size_t n_z);
+  void setRadialBounds(const BoundCond &inner, const BoundCond &outer);
+  void setEndBounds(const BoundCond &bottom, const BoundCond &top);
+  void setEnvironment(double t_amb_C, const std::string &src_path);
+  void setThreads(size_t n);
+  void setMaxTime(double t_max);
+
+  void solve(double dt, double delta_T);
+
+  const std::vector<double>& getTime() const { return time_vec; }
+  const std::vector<double>& getTw() const { return Tw_vec; }
+  const std::vector<double>& getTheta() const { return theta; }
+  size_t getNr() const { return nr; }
+  size_t getNz() const { return nz; }
+  void writeResultsFile(const std::string &path) const;
+  void writeFieldFile(const std::string &path) const;
+
+private:
+  void prepareScratch();
+  void checkBound(const BoundCond &bc) const;
+  void sweepRadial(double dt, size_t j1, size_t j2, LineScratch &s);
+  void sweepAxial(double dt, size_t i1, size_t i2, LineScratch &s);
+  void endRow(const BoundCond &bc, size_t i, double th, gsl_interp_accel *acc,
+              double *rw) const;
+};
+
+
+#endif // ADI_RZ_H
@@ -0,0 +1,302 @@
+#include "alpha_table.h"
+
+#include <math.h>
+
+
+using namespace std;
+
+
+#define ALPHA_SCAN_N 512        // Points of the search of the regimes' jumps
+#define ALPHA_JUMP_W 1e-9       // Width of the bracket of a jump, K
+#define ALPHA_MIN_W 1e-9        // Min width of the interval, K
+
+
+namespace
+{
+  // Regime of horizCylNu (the same comparisons)
+  int regimeOf(double GrPr)
+  {
+    if (GrPr > 5e2 && GrPr < 2e7)
+      return 1;
+    if (GrPr > 2e7)
+      return 2;
+    return 0;
+  }
+}
+
+
+AlphaTable::AlphaTable(const EnvModel &env, double D_out, double th_min,
+                       double th_max, double tolerance) :
+  Ta(env.getTa()), D(D_out), tol(tolerance), maxErr(0.0),
+  cellTa(0.0), D1(D_out), D2(D_out), cellErr(0.0)
+{
+  if (D <= 0.0)
+    throw err.sendEx("diameter must be > 0");
+  if (th_min >= th_max)
+    throw err.sendEx("temperature range of the table is wrong");
+  if (tol <= 0.0)
+    throw err.sendEx("tolerance must be > 0");
+
+  gsl_interp_accel *acc = gsl_interp_accel_alloc();
+
+  // Smooth pieces between the jumps of the regimes
+  vector<double> ends(1, th_min);
+  double h = (th_max - th_min) / ALPHA_SCAN_N;
+  int reg = regimeOf(env.grPr(th_min, D, acc));
+  for (size_t k = 1; k <= ALPHA_SCAN_N; ++k)
+  {
+    double x2 = (k == ALPHA_SCAN_N) ? th_max : th_min + k * h;
+    int reg2 = regimeOf(env.grPr(x2, D, acc));
+    if (reg2 == reg)
+      continue;
+
+    double lo = x2 - h, hi = x2;
+    while (hi - lo > ALPHA_JUMP_W)
+    {
+      double mid = 0.5 * (lo + hi);
+      if (regimeOf(env.grPr(mid, D, acc)) == reg)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    ends.push_back(lo);
+    ends.push_back(hi);
+    reg = reg2;
+  }
+  ends.push_back(th_max);
+
+  // Pieces are (ends[2k], ends[2k + 1])
+  for (size_t k = 0; k + 1 < ends.size(); k += 2)
+  {
+    double y1 = env.alphaConv(ends[k], D, acc);
+    double y2 = env.alphaConv(ends[k + 1], D, acc);
+    th.push_back(ends[k]);
+    al.push_back(y1);
+    refine(env, ends[k], y1, ends[k + 1], y2, acc);
+  }
+
+  // The intervals missing the tolerance are halved until it's met
+  while (!verify(env, acc)) {}
+
+  gsl_interp_accel_free(acc);
+}
+
+
+void AlphaTable::refine(const EnvModel &env, double x1, double y1,
+                        double x2, double y2, gsl_interp_accel *acc)
+{
+  // Nodes of (x1; x2] are appended: the interval is halved while
+  // the chord misses alpha_conv at the eighth points by more than tol / 2
+
+  double ym = env.alphaConv(0.5 * (x1 + x2), D, acc);
+  bool is_fine = x2 - x1 < ALPHA_MIN_W;
+  if (!is_fine)
+  {
+    double e = fabs(0.5 * (y1 + y2) - ym);
+    for (int j = 1; j < 8 && e <= 0.5 * tol; ++j)
+    {
+      double x = x1 + (x2 - x1) * j / 8.0;
+      double d = fabs(y1 + (y2 - y1) * j / 8.0 - env.alphaConv(x, D, acc));
+      if (d > e)
+        e = d;
+    }
+    is_fine = e <= 0.5 * tol;
+  }
+
+  if (is_fine)
+  {
+    th.push_back(x2);
+    al.push_back(y2);
+    return;
+  }
+  double xm = 0.5 * (x1 + x2);
+  refine(env, x1, y1, xm, ym, acc);
+  refine(env, xm, ym, x2, y2, acc);
+}
+
+
+bool AlphaTable::verify(const EnvModel &env, gsl_interp_accel *acc)
+{
+  /*
+   * Error at the odd sixteenths of every interval (the jumps' brackets
+   * are skipped). The failed intervals get their midpoints, false is
+   * returned then; maxErr is the error of the intervals kept.
+  */
+
+  vector<double> th2, al2;
+  bool is_ok = true;
+  maxErr = 0.0;
+  for (size_t i = 0; i + 1 < th.size(); ++i)
+  {
+    th2.push_back(th[i]);
+    al2.push_back(al[i]);
+    double w = th[i + 1] - th[i];
+    if (w <= ALPHA_JUMP_W)
+      continue;
+
+    double e = 0.0;
+    for (int j = 1; j < 16; j += 2)
+    {
+      double x = th[i] + w * j / 16.0;
+      double d = fabs(conv(x, acc) - env.alphaConv(x, D, acc));
+      if (d > e)
+        e = d;
+    }
+
+    if (e > tol && w >= 2.0 * ALPHA_MIN_W)
+    {
+      double xm = th[i] + 0.5 * w;
+      th2.push_back(xm);
+      al2.push_back(env.alphaConv(xm, D, acc));
+      is_ok = false;
+    }
+    else if (e > maxErr)
+      maxErr = e;
+  }
+  th2.push_back(th.back());
+  al2.push_back(al.back());
+
+  th.swap(th2);
+  al.swap(al2);
+  gsl_interp_accel_reset(acc);
+  return is_ok;
+}
+
+
+double AlphaTable::conv(double T, gsl_interp_accel *acc) const
+{
+  size_t n = th.size();
+  size_t i = (T >= th[n - 1]) ? n - 2 : gsl_interp_accel_find(acc, th.data(), n, T);
+  return al[i] + (al[i + 1] - al[i]) * (T - th[i]) / (th[i + 1] - th[i]);
+}
+
+
+bool AlphaTable::fits(double Ta_, double D_) const
+{
+  return fabs(Ta_ - Ta) <= cellTa + EPS && D_ >= D1 - EPS && D_ <= D2 + EPS;
+}
+
+
+void AlphaTable::setCell(const EnvModel &env, const EnvModel &env_lo,
+                         const EnvModel &env_hi, double D_lo, double D_hi)
+{
+  /*
+   * The table (built by env) serves Ta of env_lo ... env_hi and D_lo ... D_hi.
+   * The cell's error is alpha_conv of the corners vs the table at the nodes;
+   * the nodes whose corner is in another regime of horizCylNu are skipped:
+   * the correlation jumps there, and the shift of the jump over the cell
+   * isn't bounded by the table. The error is largest at th near Ta,
+   * where alpha_conv ~ (th - Ta)^(1/4) is steep in Ta.
+  */
+
+  if (D_lo > D || D_hi < D || env_lo.getTa() > Ta || env_hi.getTa() < Ta)
+    throw err.sendEx("cell of the table doesn't contain its Ta and D");
+
+  gsl_interp_accel *acc = gsl_interp_accel_alloc();
+  const EnvModel *envs[2] = { &env_lo, &env_hi };
+  double Ds[2] = { D_lo, D_hi };
+  cellErr = 0.0;
+  for (size_t i = 0; i < th.size(); ++i)
+  {
+    int reg = regimeOf(env.grPr(th[i], D, acc));
+    for (int k = 0; k < 4; ++k)
+    {
+      const EnvModel &e = *envs[k / 2];
+      double d = Ds[k % 2];
+      if (regimeOf(e.grPr(th[i], d, acc)) != reg)
+        continue;
+      double err_k = fabs(e.alphaConv(th[i], d, acc) - al[i]);
+      if (err_k > cellErr)
+        cellErr = err_k;
+    }
+  }
+  gsl_interp_accel_free(acc);
+
+  cellTa = 0.5 * (env_hi.getTa() - env_lo.getTa());
+  D1 = D_lo;
+  D2 = D_hi;
+}
+
+
+// *** AlphaTables ***
+AlphaTables::AlphaTables(double th_min, double th_max, double tolerance,
+                         double Ta_step, double D_step, size_t max_n) :
+  thMin(th_min), thMax(th_max), tol(tolerance),
+  stepTa(Ta_step), stepD(D_step), maxN(max_n), requests(0)
+{
+  if (th_min >= th_max)
+    throw err.sendEx("temperature range of the table is wrong");
+  if (tol <= 0.0)
+    throw err.sendEx("tolerance must be > 0");
+  if (Ta_step < 0.0 || D_step < 0.0)
+    throw err.sendEx("quanta of Ta and D must be >= 0");
+  if (max_n == 0)
+    throw err.sendEx("at least one table must be kept");
+}
+
+
+shared_ptr<const AlphaTable> AlphaTables::get(const string &env_path,
+                                              double Ta_C, double D)
+{
+  /*
+   * The lock covers the map only: the table is built by the first
+   * request of its cell, the requests of the same cell wait for it
+   * (a failed build is retried by the next request).
+  */
+
+  if (D <= 0.0)
+    throw err.sendEx("diameter must be > 0");
+  double Ta_q = (stepTa > 0.0) ? stepTa * round(Ta_C / stepTa) : Ta_C;
+  double D_q = (stepD > 0.0) ? exp(stepD * round(log(D) / stepD)) : D;
+
+  shared_ptr<Entry> e;
+  {
+    lock_guard<mutex> lock(mx);
+    Key key(env_path, Ta_q, D_q);
+    shared_ptr<Entry> &slot = tables[key];
+    if (!slot)
+      slot = make_shared<Entry>();
+    e = slot;
+    e->used = ++requests;
+
+    // The least recently used tables are dropped (the users keep them)
+    while (tables.size() > maxN)
+    {
+      map<Key, shared_ptr<Entry> >::iterator old = tables.begin();
+      for (map<Key, shared_ptr<Entry> >::iterator it = tables.begin();
+           it != tables.end(); ++it)
+        if (it->second->used < old->second->used)
+          old = it;
+      tables.erase(old);
+    }
+  }
+
+  call_once(e->built, [&]()
+  {
+    e->table = shared_ptr<const AlphaTable>(build(env_path, Ta_q, D_q));
+  });
+  return e->table;
+}
+
+
+size_t AlphaTables::size()
+{
+  lock_guard<mutex> lock(mx);
+  return tables.size();
+}
+
+
+// *** PRIVATE ***
+AlphaTable* AlphaTables::build(const string &env_path, double Ta_C, double D) const
+{
+  // Table of the cell's center with the error over the cell
+
+  EnvModel env(Ta_C, env_path);
+  unique_ptr<AlphaTable> t(new AlphaTable(env, D, thMin, thMax, tol));
+
+  EnvModel env_lo(Ta_C - 0.5 * stepTa, env_path);
+  EnvModel env_hi(Ta_C + 0.5 * stepTa, env_path);
+  t->setCell(env, env_lo, env_hi, D * exp(-0.5 * stepD), D * exp(0.5 * stepD));
+  return t.release();
+}
+// *** END OF AlphaTables ***
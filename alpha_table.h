@@ -0,0 +1,123 @@
+#ifndef ALPHA_TABLE_H
+#define ALPHA_TABLE_H
+
+#include <gsl/gsl_interp.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "err.h"
+#include "env_model.h"
+
+#define ALPHA_TABLES_MAX 32       // Tables kept by AlphaTables by default
+
+
+/*
+ * Precomputed natural convection coefficient alpha_conv(th) of the
+ * horizontal cylinder for one environment (Ta, air table) and diameter.
+ * Nodes are refined until the linear interpolation is within the absolute
+ * tolerance; the jumps of the correlation's regimes (horizCylNu) are
+ * bracketed by the nodes, so no interval crosses them.
+ * The nodes are verified between them and the intervals missing the
+ * tolerance are refined again; getMaxError() is the verified error.
+ * The table may serve the cell of (Ta, D) around its own ones (see
+ * AlphaTables); getCellError() is the change of alpha_conv over the cell.
+ * The table is read-only after the construction: one table may be shared
+ * by many solvers and threads (each with its own accelerator).
+*/
+class AlphaTable
+{
+private:
+  mutable Error err;
+
+  double Ta, D;
+  double tol;                     // Max error of alpha_conv, W/(m^2 K)
+  double maxErr;                  // Max error found by the verification
+  std::vector<double> th, al;     // Nodes
+
+  // Cell of (Ta, D) served by the table
+  double cellTa;                  // Half width of Ta, K
+  double D1, D2;                  // Range of D
+  double cellErr;                 // Max change of alpha_conv over the cell
+
+public:
+  AlphaTable(const EnvModel &env, double D_out, double th_min, double th_max,
+             double tolerance = 1e-3);
+
+  bool covers(double T) const { return T >= th.front() && T <= th.back(); }
+  double conv(double T, gsl_interp_accel *acc) const;
+
+  double getTa() const { return Ta; }
+  double getD() const { return D; }
+  double getTolerance() const { return tol; }
+  double getMaxError() const { return maxErr; }
+  double getCellError() const { return cellErr; }
+  size_t size() const { return th.size(); }
+  bool fits(double Ta_, double D_) const;
+
+  void setCell(const EnvModel &env, const EnvModel &env_lo,
+               const EnvModel &env_hi, double D_lo, double D_hi);
+
+private:
+  void refine(const EnvModel &env, double x1, double y1, double x2, double y2,
+              gsl_interp_accel *acc);
+  bool verify(const EnvModel &env, gsl_interp_accel *acc);
+};
+
+
+/*
+ * Tables of many environments and diameters (e.g. for the sweeps
+ * of Ta or the radius). Ta and ln D are quantized by the steps:
+ * a table is built at the center of the cell of the requested values
+ * and serves all of the cell, its error is getMaxError() + getCellError().
+ * Zero step - the exact value is the key. At most max_n tables are kept
+ * (the least recently used are dropped, the solvers keep theirs alive).
+ * Thread-safe: a table is built once, out of the lock of the others.
+*/
+class AlphaTables
+{
+private:
+  mutable Error err;
+
+  double thMin, thMax, tol;       // Range and tolerance of every table
+  double stepTa, stepD;           // Quanta of Ta (K) and of ln D
+  size_t maxN;                    // Max number of the kept tables
+
+  struct Entry
+  {
+    std::once_flag built;
+    std::shared_ptr<const AlphaTable> table;
+    size_t used;                  // Last request (for the eviction)
+  };
+
+  typedef std::tuple<std::string, double, double> Key;   // Path, Ta_C, D
+  std::mutex mx;
+  std::map<Key, std::shared_ptr<Entry> > tables;
+  size_t requests;
+
+public:
+  AlphaTables(double th_min, double th_max, double tolerance = 1e-3,
+              double Ta_step = 0.1, double D_step = 1e-3,
+              size_t max_n = ALPHA_TABLES_MAX);
+
+  AlphaTables(const AlphaTables&) = delete;
+  AlphaTables& operator=(const AlphaTables&) = delete;
+
+  std::shared_ptr<const AlphaTable> get(const std::string &env_path,
+                                        double Ta_C, double D);
+
+  double getTolerance() const { return tol; }
+  double getTaStep() const { return stepTa; }
+  double getDStep() const { return stepD; }
+  size_t size();
+
+private:
+  AlphaTable* build(const std::string &env_path, double Ta_C, double D) const;
+};
+
+
+#endif // ALPHA_TABLE_H
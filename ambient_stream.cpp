@@ -0,0 +1,97 @@
+#include "ambient_stream.h"
+#include "types.h"
+
+
+using namespace std;
+
+
+double AmbientStream::Cursor::at(double t)
+{
+  // The cursor moves forward with the time (backward after a reset)
+
+  const double *x = s->x();
+  const double *y = s->y();
+  size_t n = s->size();
+
+  if (t <= x[0])
+  {
+    i = 0;
+    return y[0];
+  }
+  if (t >= x[n - 1])
+  {
+    i = n - 1;
+    return y[n - 1];
+  }
+
+  while (x[i + 1] <= t)
+    i++;
+  while (x[i] > t)
+    i--;
+
+  if (i >= released + AMBIENT_RELEASE_N)
+  {
+    s->release(i);
+    released = i;
+  }
+  else if (i < released)
+    released = i;   // Released pages are read from the file again
+
+  return y[i] + (y[i + 1] - y[i]) * (t - x[i]) / (x[i + 1] - x[i]);
+}
+
+
+AmbientStream::AmbientStream(const string &T_path, const string &v_path) :
+  T(T_path), v(nullptr), curT(&T), curV(nullptr)
+{
+  checkSeries(T, false);
+  if (v_path.empty())
+    return;
+
+  v = new MappedSeries(v_path);
+  try
+  {
+    checkSeries(*v, true);
+  }
+  catch (const string &)
+  {
+    delete v;
+    throw;
+  }
+  curV = Cursor(v);
+}
+
+
+AmbientStream::~AmbientStream()
+{
+  delete v;
+}
+
+
+void AmbientStream::checkSeries(const MappedSeries &s, bool is_positive) const
+{
+  // One pass over the file, its pages are released after it
+
+  if (s.size() == 0)
+    throw err.sendEx("ambient series is empty");
+  for (size_t i = 0; i < s.size(); ++i)
+  {
+    if (i > 0 && s.x()[i] <= s.x()[i - 1])
+      throw err.sendEx("time of the ambient series must increase");
+    if (is_positive && s.y()[i] < 0.0)
+      throw err.sendEx("velocity must be >= 0");
+  }
+  s.release(s.size());
+}
+
+
+double AmbientStream::getTa(double t)
+{
+  return curT.at(t) + T_ABS;
+}
+
+
+double AmbientStream::getVelocity(double t)
+{
+  return v ? curV.at(t) : 0.0;
+}
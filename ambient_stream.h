@@ -0,0 +1,56 @@
+#ifndef AMBIENT_STREAM_H
+#define AMBIENT_STREAM_H
+
+#include <string>
+
+#include "err.h"
+#include "mapped_series.h"
+
+#define AMBIENT_RELEASE_N 65536   // Points passed by the cursor to release
+
+
+/*
+ * Measured ambient history for the type 3 bound: T_amb(t) and optionally
+ * the air velocity v(t) of the forced convection. Both are series files
+ * (see MappedSeries, x - time in s, y - T in C or v in m/s) mapped into
+ * memory and read by a moving cursor: the pages behind it are released,
+ * so a long recording takes bounded memory. Values are interpolated
+ * linearly, out of a series the end values are kept.
+ * The cursor belongs to one solver (the class isn't thread-safe).
+*/
+class AmbientStream
+{
+private:
+  mutable Error err;
+
+  struct Cursor
+  {
+    const MappedSeries *s;
+    size_t i;                 // x[i] <= t < x[i + 1] for the last t
+    size_t released;          // Points released behind the cursor
+
+    explicit Cursor(const MappedSeries *ms) : s(ms), i(0), released(0) {}
+    double at(double t);
+  };
+
+  MappedSeries T;
+  MappedSeries *v;            // May be null
+  Cursor curT, curV;
+
+public:
+  AmbientStream(const std::string &T_path, const std::string &v_path = "");
+  ~AmbientStream();
+
+  AmbientStream(const AmbientStream&) = delete;
+  AmbientStream& operator=(const AmbientStream&) = delete;
+
+  double getTa(double t);           // K
+  double getVelocity(double t);     // m/s (0 without the velocity series)
+  bool hasVelocity() const { return v != nullptr; }
+
+private:
+  void checkSeries(const MappedSeries &s, bool is_positive) const;
+};
+
+
+#endif // AMBIENT_STREAM_H
@@ -0,0 +1,165 @@
+#include "compare_plotter.h"
+
+#include <QFont>
+#include <QPainter>
+#include <QPointF>
+#include <QVector>
+
+#include <fstream>
+#include <utility>
+
+
+using namespace QtCharts;
+using namespace std;
+
+
+ComparePlotter::ComparePlotter()
+{
+  axisX = new QValueAxis();
+  axisY = new QValueAxis();
+  chart = new QChart();
+  chartView = new QChartView();
+
+  chart->addAxis(axisX, Qt::AlignBottom);
+  chart->addAxis(axisY, Qt::AlignLeft);
+
+  // Level of detail follows the zoom of the X axis
+  QObject::connect(axisX, &QValueAxis::rangeChanged, [this]() { redraw(); });
+  chartView->setRubberBand(QChartView::HorizontalRubberBand);
+}
+
+
+ComparePlotter::~ComparePlotter()
+{
+  for (size_t i = 0; i < curves.size(); ++i)
+  {
+    delete curves[i]->map;
+    delete curves[i];
+  }
+}
+
+
+void ComparePlotter::addRun(const string &path, const QString &name)
+{
+  /*
+   * Computed run (see ImplicitDiffSchemeCyl::writeResultsBin()).
+   * The file isn't loaded: the pyramid keeps only the coarse levels
+   * and the finer data are read from the mapping when zoomed in.
+  */
+
+  unique_ptr<Curve> c(new Curve());
+  try
+  {
+    c->map = new MappedSeries(path);
+    c->data.attach(c->map->x(), c->map->y(), c->map->size());
+  }
+  catch (const string&)
+  {
+    delete c->map;
+    throw;
+  }
+
+  c->series = new QLineSeries();
+  addCurve(move(c), name);
+}
+
+
+void ComparePlotter::addExperiment(const string &path, bool isHead,
+                                   const QString &name)
+{
+  // Measured points are few, so they're read at once
+
+  fstream file(path.c_str(), ios_base::in);
+  if (!file.is_open())
+    throw err.sendEx("file is not opened");
+
+  // The curve is owned here until the plotter takes it
+  unique_ptr<Curve> c(new Curve());
+  c->map = nullptr;
+
+  if (isHead)
+  {
+    string head;
+    getline(file, head);
+  }
+  double x, y;
+  while (file >> x >> y)
+    c->data.append(x, y);
+  file.close();
+
+  QScatterSeries *s = new QScatterSeries();
+  s->setMarkerSize(6.0);
+  c->series = s;
+  addCurve(move(c), name);
+}
+
+
+void ComparePlotter::setAxis(double x_min, double x_max,
+                             double y_min, double y_max,
+                             int x_ticks, int y_ticks)
+{
+  if (x_min > x_max || y_min > y_max)
+    throw err.sendEx("minimum value of X or Y > maximum of it");
+  if (x_ticks < 2 || y_ticks < 2)
+    throw err.sendEx("ticks must be > 1");
+
+  QFont labFont("Times New Roman");
+  labFont.setPixelSize(14);
+  axisX->setLabelsFont(labFont);
+  axisY->setLabelsFont(labFont);
+
+  QFont textFont("Times New Roman");
+  textFont.setPixelSize(18);
+  axisX->setTitleFont(textFont);
+  axisY->setTitleFont(textFont);
+
+  axisX->setRange(x_min, x_max);
+  axisX->setTickCount(x_ticks);
+  axisX->setTitleText("Время, сек");
+
+  axisY->setRange(y_min, y_max);
+  axisY->setTickCount(y_ticks);
+  axisY->setTitleText("Температура стенки, градусы Цельсия");
+}
+
+
+QChartView* ComparePlotter::getChartView()
+{
+  chartView->setChart(chart);
+  chartView->setRenderHint(QPainter::Antialiasing);
+  return chartView;
+}
+
+
+void ComparePlotter::addCurve(unique_ptr<Curve> c, const QString &name)
+{
+  c->series->setName(name);
+  chart->addSeries(c->series);
+  c->series->attachAxis(axisX);
+  c->series->attachAxis(axisY);
+  curves.push_back(c.get());
+  c.release();
+
+  redraw();
+}
+
+
+void ComparePlotter::redraw()
+{
+  // Each curve gets about two points per pixel of the visible range
+
+  size_t width = size_t(chart->plotArea().width());
+  if (width == 0)
+    width = 1000;
+
+  vector<double> xs, ys;
+  for (size_t i = 0; i < curves.size(); ++i)
+  {
+    curves[i]->data.query(axisX->min(), axisX->max(), width, xs, ys);
+
+    QVector<QPointF> points(int(xs.size()));
+    for (size_t j = 0; j < xs.size(); ++j)
+      points[int(j)] = QPointF(xs[j], ys[j]);
+    curves[i]->series->replace(points);
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef COMPARE_PLOTTER_H
+#define COMPARE_PLOTTER_H
+
+#include <QtCharts/QChart>
+#include <QtCharts/QChartView>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QScatterSeries>
+#include <QtCharts/QValueAxis>
+
+#include <QString>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "err.h"
+#include "decim_pyramid.h"
+#include "mapped_series.h"
+
+
+/*
+ * Overlay of many computed runs (memory-mapped binary results)
+ * and experimental datasets (text "x y" files) on one chart.
+*/
+class ComparePlotter
+{
+private:
+  Error err;
+
+  struct Curve
+  {
+    QtCharts::QXYSeries *series;
+    MappedSeries *map;          // Null for the experimental data
+    DecimPyramid data;
+  };
+  std::vector<Curve*> curves;
+
+  QtCharts::QValueAxis *axisX, *axisY;
+  QtCharts::QChart *chart;
+  QtCharts::QChartView *chartView;
+
+public:
+  ComparePlotter();
+  ~ComparePlotter();
+
+  void addRun(const std::string &path, const QString &name);
+  void addExperiment(const std::string &path, bool isHead, const QString &name);
+  void setAxis(double x_min, double x_max,
+               double y_min, double y_max,
+               int x_ticks, int y_ticks);
+  QtCharts::QChartView* getChartView();
+
+private:
+  void addCurve(std::unique_ptr<Curve> c, const QString &name);
+  void redraw();
+};
+
+
+#endif // COMPARE_PLOTTER_H
@@ -0,0 +1,223 @@
+#include "decim_pyramid.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+void DecimPyramid::append(double xi, double yi)
+{
+  if (px && px != x.data())
+    throw err.sendEx("external data can't be appended");
+  if (n > 0 && xi < x.back())
+    throw err.sendEx("x of the series must be nondecreasing");
+
+  x.push_back(xi);
+  y.push_back(yi);
+  px = x.data();
+  py = y.data();
+  n++;
+
+  addLevels();
+}
+
+
+void DecimPyramid::append(const double *xs, const double *ys, size_t size)
+{
+  x.reserve(x.size() + size);
+  y.reserve(y.size() + size);
+  for (size_t i = 0; i < size; ++i)
+    append(xs[i], ys[i]);
+}
+
+
+void DecimPyramid::attach(const double *xs, const double *ys, size_t size,
+                          size_t min_level)
+{
+  /*
+   * Use the external data without copying.
+   * Buckets smaller than 2^min_level points aren't stored.
+  */
+
+  clear();
+  if (min_level < 1)
+    min_level = 1;
+  minLevel = min_level;
+  px = xs;
+  py = ys;
+
+  for (n = 1; n <= size; ++n)
+  {
+    if (n > 1 && px[n - 1] < px[n - 2])
+    {
+      clear();
+      throw err.sendEx("x of the series must be nondecreasing");
+    }
+    addLevels();
+  }
+  n = size;
+}
+
+
+void DecimPyramid::addLevels()
+{
+  // Every completed pair of level k - 1 buckets makes a bucket of level k
+
+  for (size_t k = 1; n % (size_t(1) << k) == 0; ++k)
+  {
+    if (levels.size() < k)
+      levels.push_back(vector<Bucket>());
+    if (k < minLevel)
+      continue;
+
+    size_t j = (n >> k) - 1;
+    Bucket b;
+    if (k == minLevel)
+      b = scanBucket(j << k, size_t(1) << k);   // The finest stored level
+    else
+    {
+      const Bucket &c0 = levels[k - 2][2 * j];
+      const Bucket &c1 = levels[k - 2][2 * j + 1];
+      b.iMin = (py[c1.iMin] < py[c0.iMin]) ? c1.iMin : c0.iMin;
+      b.iMax = (py[c1.iMax] > py[c0.iMax]) ? c1.iMax : c0.iMax;
+    }
+    levels[k - 1].push_back(b);
+  }
+}
+
+
+void DecimPyramid::clear()
+{
+  x.clear();
+  y.clear();
+  px = py = nullptr;
+  n = 0;
+  minLevel = 1;
+  levels.clear();
+}
+
+
+void DecimPyramid::swap(DecimPyramid &other)
+{
+  // O(1): the own raw data keep their buffers, so px, py stay valid
+
+  x.swap(other.x);
+  y.swap(other.y);
+  std::swap(px, other.px);
+  std::swap(py, other.py);
+  std::swap(n, other.n);
+  std::swap(minLevel, other.minLevel);
+  levels.swap(other.levels);
+}
+
+
+double DecimPyramid::xMin() const
+{
+  if (n == 0)
+    throw err.sendEx("series is empty");
+  return px[0];
+}
+
+
+double DecimPyramid::xMax() const
+{
+  if (n == 0)
+    throw err.sendEx("series is empty");
+  return px[n - 1];
+}
+
+
+void DecimPyramid::query(double x1, double x2, size_t buckets,
+                         vector<double> &xs, vector<double> &ys) const
+{
+  /*
+   * The coarsest level with no more than 'buckets' buckets in the range
+   * is used; the incomplete tail is covered by the finer levels.
+   * One point out of the range on each side is kept for the lines' ends.
+  */
+
+  xs.clear();
+  ys.clear();
+  if (n == 0)
+    return;
+  if (buckets == 0)
+    buckets = 1;
+
+  size_t i1 = lowerIndex(x1);
+  size_t i2 = upperIndex(x2);
+  if (i1 > 0)
+    i1--;
+  if (i2 < n)
+    i2++;
+
+  size_t k = 0;
+  while (k < levels.size() && ((i2 - i1) >> k) > buckets)
+    k++;
+
+  size_t pos = (i1 >> k) << k;
+  while (pos < i2)
+  {
+    size_t l = k;
+    while (l > 0 && (pos % (size_t(1) << l) != 0 || pos + (size_t(1) << l) > n))
+      l--;
+
+    if (l == 0)
+    {
+      xs.push_back(px[pos]);
+      ys.push_back(py[pos]);
+      pos++;
+      continue;
+    }
+    // Levels below minLevel are found from the raw data
+    if (l < minLevel)
+      emitBucket(scanBucket(pos, size_t(1) << l), xs, ys);
+    else
+      emitBucket(levels[l - 1][pos >> l], xs, ys);
+    pos += size_t(1) << l;
+  }
+}
+
+
+size_t DecimPyramid::lowerIndex(double xv) const
+{
+  return lower_bound(px, px + n, xv) - px;
+}
+
+
+size_t DecimPyramid::upperIndex(double xv) const
+{
+  return upper_bound(px, px + n, xv) - px;
+}
+
+
+DecimPyramid::Bucket DecimPyramid::scanBucket(size_t i1, size_t len) const
+{
+  Bucket b;
+  b.iMin = b.iMax = i1;
+  for (size_t i = i1 + 1; i < i1 + len; ++i)
+  {
+    if (py[i] < py[b.iMin])
+      b.iMin = i;
+    if (py[i] > py[b.iMax])
+      b.iMax = i;
+  }
+  return b;
+}
+
+
+void DecimPyramid::emitBucket(const Bucket &b,
+                              vector<double> &xs, vector<double> &ys) const
+{
+  // Extremes are kept in the order of x
+
+  size_t i1 = min(b.iMin, b.iMax);
+  size_t i2 = max(b.iMin, b.iMax);
+  xs.push_back(px[i1]);
+  ys.push_back(py[i1]);
+  if (i2 != i1)
+  {
+    xs.push_back(px[i2]);
+    ys.push_back(py[i2]);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef DECIM_PYRAMID_H
+#define DECIM_PYRAMID_H
+
+#include <vector>
+#include <cstddef>
+
+#include "err.h"
+
+
+/*
+ * Multi-resolution (min/max) decimation of the series y(x) for plotting.
+ * Level k consists of buckets of 2^k points, each bucket keeps the indices
+ * of its minimum and maximum. Points are appended incrementally in O(1)
+ * (amortized), x must be nondecreasing.
+ * The data may be external (e.g. a memory-mapped file), then the levels
+ * below minLevel aren't stored and the raw data are read only when needed.
+*/
+class DecimPyramid
+{
+private:
+  mutable Error err;
+
+  struct Bucket
+  {
+    size_t iMin, iMax;
+  };
+
+  std::vector<double> x, y;                   // Level 0 (own raw data)
+  const double *px, *py;                      // Level 0 (own or external)
+  size_t n;                                   // Size of level 0
+  size_t minLevel;                            // The finest stored level
+  std::vector<std::vector<Bucket> > levels;   // levels[k - 1] is level k
+
+public:
+  DecimPyramid() : px(nullptr), py(nullptr), n(0), minLevel(1) {}
+
+  void append(double xi, double yi);
+  void append(const double *xs, const double *ys, size_t size);
+  void attach(const double *xs, const double *ys, size_t size,
+              size_t min_level = 6);
+  void clear();
+  void swap(DecimPyramid &other);
+
+  size_t size() const { return n; }
+  double xMin() const;
+  double xMax() const;
+
+  // Points of [x1; x2] with about 2 * buckets points at most
+  void query(double x1, double x2, size_t buckets,
+             std::vector<double> &xs, std::vector<double> &ys) const;
+
+private:
+  size_t lowerIndex(double xv) const;
+  size_t upperIndex(double xv) const;
+  void addLevels();
+  Bucket scanBucket(size_t i1, size_t len) const;
+  void emitBucket(const Bucket &b,
+                  std::vector<double> &xs, std::vector<double> &ys) const;
+};
+
+
+#endif // DECIM_PYRAMID_H
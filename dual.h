@@ -0,0 +1,159 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cstddef>
+#include <math.h>
+
+
+/*
+ * Forward-mode dual number: the value and N derivatives with respect to
+ * the seeded parameters. Comparisons use the value only.
+*/
+template <size_t N>
+struct Dual
+{
+  double v;         // Value
+  double d[N];      // Derivatives
+
+  Dual(double x = 0.0) : v(x)
+  {
+    for (size_t i = 0; i < N; ++i)
+      d[i] = 0.0;
+  }
+
+  Dual& operator+=(const Dual &b)
+  {
+    v += b.v;
+    for (size_t i = 0; i < N; ++i)
+      d[i] += b.d[i];
+    return *this;
+  }
+  Dual& operator-=(const Dual &b)
+  {
+    v -= b.v;
+    for (size_t i = 0; i < N; ++i)
+      d[i] -= b.d[i];
+    return *this;
+  }
+  Dual& operator*=(const Dual &b)
+  {
+    for (size_t i = 0; i < N; ++i)
+      d[i] = d[i] * b.v + v * b.d[i];
+    v *= b.v;
+    return *this;
+  }
+  Dual& operator/=(const Dual &b)
+  {
+    double inv = 1.0 / b.v;
+    v *= inv;
+    for (size_t i = 0; i < N; ++i)
+      d[i] = (d[i] - v * b.d[i]) * inv;
+    return *this;
+  }
+};
+
+
+template <size_t N>
+inline Dual<N> operator-(Dual<N> a)
+{
+  a.v = -a.v;
+  for (size_t i = 0; i < N; ++i)
+    a.d[i] = -a.d[i];
+  return a;
+}
+
+template <size_t N>
+inline Dual<N> operator+(Dual<N> a, const Dual<N> &b) { return a += b; }
+template <size_t N>
+inline Dual<N> operator-(Dual<N> a, const Dual<N> &b) { return a -= b; }
+template <size_t N>
+inline Dual<N> operator*(Dual<N> a, const Dual<N> &b) { return a *= b; }
+template <size_t N>
+inline Dual<N> operator/(Dual<N> a, const Dual<N> &b) { return a /= b; }
+
+template <size_t N>
+inline Dual<N> operator+(Dual<N> a, double b) { a.v += b; return a; }
+template <size_t N>
+inline Dual<N> operator+(double a, Dual<N> b) { b.v += a; return b; }
+template <size_t N>
+inline Dual<N> operator-(Dual<N> a, double b) { a.v -= b; return a; }
+template <size_t N>
+inline Dual<N> operator-(double a, const Dual<N> &b) { return Dual<N>(a) - b; }
+template <size_t N>
+inline Dual<N> operator*(Dual<N> a, double b)
+{
+  a.v *= b;
+  for (size_t i = 0; i < N; ++i)
+    a.d[i] *= b;
+  return a;
+}
+template <size_t N>
+inline Dual<N> operator*(double a, const Dual<N> &b) { return b * a; }
+template <size_t N>
+inline Dual<N> operator/(const Dual<N> &a, double b) { return a * (1.0 / b); }
+template <size_t N>
+inline Dual<N> operator/(double a, const Dual<N> &b) { return Dual<N>(a) / b; }
+
+template <size_t N>
+inline bool operator<(const Dual<N> &a, const Dual<N> &b) { return a.v < b.v; }
+template <size_t N>
+inline bool operator>(const Dual<N> &a, const Dual<N> &b) { return a.v > b.v; }
+template <size_t N>
+inline bool operator<(const Dual<N> &a, double b) { return a.v < b; }
+template <size_t N>
+inline bool operator>(const Dual<N> &a, double b) { return a.v > b; }
+
+
+// *** Functions ***
+template <size_t N>
+inline Dual<N> pow(const Dual<N> &a, double n)
+{
+  Dual<N> r(::pow(a.v, n));
+  double df = (n == 0.0) ? 0.0 : n * ::pow(a.v, n - 1.0);
+  for (size_t i = 0; i < N; ++i)
+    r.d[i] = df * a.d[i];
+  return r;
+}
+
+
+template <size_t N>
+inline Dual<N> cbrt(const Dual<N> &a)
+{
+  Dual<N> r(::cbrt(a.v));
+  double df = (r.v == 0.0) ? 0.0 : 1.0 / (3.0 * r.v * r.v);
+  for (size_t i = 0; i < N; ++i)
+    r.d[i] = df * a.d[i];
+  return r;
+}
+
+
+// Value of the scalar (double or dual)
+inline double valueOf(double x) { return x; }
+template <size_t N>
+inline double valueOf(const Dual<N> &x) { return x.v; }
+
+
+// f(x) given by its value f and derivative df at the value of x
+inline double chainRule(double f, double, double) { return f; }
+template <size_t N>
+inline Dual<N> chainRule(double f, double df, const Dual<N> &x)
+{
+  Dual<N> r(f);
+  for (size_t i = 0; i < N; ++i)
+    r.d[i] = df * x.d[i];
+  return r;
+}
+
+
+// Mark x as the k-th parameter (dx/dp_k = dk)
+inline void seedDual(double&, size_t, double) {}
+template <size_t N>
+inline void seedDual(Dual<N> &x, size_t k, double dk = 1.0)
+{
+  if (k < N)
+    x.d[k] = dk;
+}
+// *** END OF Functions ***
+
+
+#endif // DUAL_H
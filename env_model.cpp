@@ -0,0 +1,132 @@
+#include "env_model.h"
+
+#include <fstream>
+#include <math.h>
+
+
+using namespace std;
+
+
+void horizCylNuShape(size_t n, vector<double> &shape)
+{
+  /*
+   * Laminar boundary layer solution (Merk, Prins):
+   * Nu(phi) ~ sin(phi)^(1/3) / (int_0^phi sin(t)^(1/3) dt)^(1/4),
+   * (4/3)^(1/4) at the bottom, 0 at the top. The plume region
+   * is limited by a quarter of the bottom value. Shape is normalized
+   * to the mean 1, so the mean correlation (horizCylNu) is kept.
+  */
+
+  const size_t m = 64;        // Integration substeps of a segment
+  const double s0 = pow(4.0 / 3.0, 0.25);
+  double h = M_PI / (n * m);
+
+  shape.assign(n + 1, s0);
+  double I = 0.0;
+  for (size_t k = 1; k <= n; ++k)
+  {
+    for (size_t j = 0; j < m; ++j)
+      I += pow(sin(((k - 1) * m + j + 0.5) * h), 1.0 / 3.0) * h;
+    double s = pow(sin(M_PI * k / n), 1.0 / 3.0) / pow(I, 0.25);
+    shape[k] = (s > 0.25 * s0) ? s : 0.25 * s0;
+  }
+
+  double mean = 0.0;
+  for (size_t k = 0; k <= n; ++k)
+    mean += (k == 0 || k == n) ? 0.5 * shape[k] : shape[k];
+  mean /= n;
+  for (size_t k = 0; k <= n; ++k)
+    shape[k] /= mean;
+}
+
+
+EnvModel::EnvModel(double t_amb_C, const string &path)
+{
+  if (t_amb_C < -T_ABS)
+    throw err.sendEx("temperature is set less than absolute 0");
+  Ta = t_amb_C + T_ABS;
+
+  fstream f(path.c_str(), ios_base::in);
+  if (!f.is_open())
+    throw err.sendEx("file is not opened");
+
+  double t, l, rho, c, a, v, mu, pr;
+  while (f >> t >> l >> rho >> c >> a >> v >> mu >> pr)
+  {
+    T.push_back(t + T_ABS);
+    lam.push_back(l);
+    nu.push_back(v);
+    Pr.push_back(pr);
+  }
+  f.close();
+
+  size_t n = T.size();
+  if (n < 5)
+    throw err.sendEx("environment table is too short for the Akima spline");
+
+  const vector<double> *y[3] = { &lam, &nu, &Pr };
+  for (int i = 0; i < 3; ++i)
+  {
+    sp[i] = gsl_spline_alloc(gsl_interp_akima, n);
+    gsl_spline_init(sp[i], T.data(), y[i]->data(), n);
+  }
+}
+
+
+EnvModel::~EnvModel()
+{
+  for (int i = 0; i < 3; ++i)
+    gsl_spline_free(sp[i]);
+}
+
+
+double EnvModel::eval(Prop p, double T_, gsl_interp_accel *acc) const
+{
+  return gsl_spline_eval(sp[p], T_, acc);
+}
+
+
+double EnvModel::deriv(Prop p, double T_, gsl_interp_accel *acc) const
+{
+  return gsl_spline_eval_deriv(sp[p], T_, acc);
+}
+
+
+double EnvModel::prop(Prop p, double T_, gsl_interp_accel *acc) const
+{
+  return eval(p, T_, acc);
+}
+
+
+double EnvModel::grPr(double th, double D, gsl_interp_accel *acc) const
+{
+  return grPr<double>(th, Ta, D, acc);
+}
+
+
+double EnvModel::alphaConv(double th, double D, gsl_interp_accel *acc) const
+{
+  return alphaConv<double>(th, Ta, D, 0.0, acc);
+}
+
+
+double EnvModel::alphaSum(double th, double D, double eps,
+                          gsl_interp_accel *acc) const
+{
+  return alphaConv(th, D, acc) + alphaRad(th, Ta, eps);
+}
+
+
+ostream& operator<<(ostream &os, const EnvModel &e)
+{
+  os << "\t..... ENVIRONMENT .....\n";
+  os << "\tt, C\t\tlambda\t\tnu\t\tPr\n";
+  for (size_t i = 0; i < e.T.size(); ++i)
+    os << '\t' << e.T[i] - T_ABS
+       << "\t\t" << e.lam[i]
+       << "\t\t" << e.nu[i]
+       << "\t\t" << e.Pr[i] << '\n';
+
+  os << '\n';
+  return os;
+}
@@ -0,0 +1,175 @@
+#ifndef ENV_MODEL_H
+#define ENV_MODEL_H
+
+#include <gsl/gsl_interp.h>
+#include <gsl/gsl_spline.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <math.h>
+
+#include "types.h"
+#include "dual.h"
+
+
+// Nusselt number of the natural convection of the horizontal cylinder
+// (mean over the circumference), GrPr = Gr * Pr
+template <class Real>
+Real horizCylNu(const Real &GrPr)
+{
+  double  c = 0.0,
+          n = 0.0;
+
+  if (GrPr > 5e2 && GrPr < 2e7)
+  {
+    c = 0.54;
+    n = 0.25;
+  }
+  else if (GrPr > 2e7)
+  {
+    c = 0.135;
+    n = 0.333;
+  }
+  return c * pow(GrPr, n);
+}
+
+
+// Nusselt number of the cylinder in the cross flow (Hilpert),
+// Re = v * D / nu
+template <class Real>
+Real crossCylNu(const Real &Re, const Real &Pr)
+{
+  double  c = 0.989,
+          m = 0.330;
+
+  if (Re > 4e4)
+  {
+    c = 0.027;
+    m = 0.805;
+  }
+  else if (Re > 4e3)
+  {
+    c = 0.193;
+    m = 0.618;
+  }
+  else if (Re > 40.0)
+  {
+    c = 0.683;
+    m = 0.466;
+  }
+  else if (Re > 4.0)
+  {
+    c = 0.911;
+    m = 0.385;
+  }
+  return c * pow(Re, m) * pow(Pr, 1.0 / 3.0);
+}
+
+
+// Local / mean Nusselt number of the horizontal cylinder at n + 1 angles
+// phi_k = pi * k / n from the bottom (laminar boundary layer)
+void horizCylNuShape(size_t n, std::vector<double> &shape);
+
+
+/*
+ * Ambient air: the table of the environment file (Akima splines)
+ * and the heat emission of the cylinder's surface.
+ * Const methods are thread-safe if every thread has its own accelerator
+ * (or passes null). The templates take the ambient temperature apart
+ * (it may vary, see AmbientStream) and run on Dual as well.
+*/
+class EnvModel
+{
+public:
+  enum Prop { ENV_LAMBDA, ENV_NU, ENV_PR };
+
+private:
+  Error err;
+
+  double Ta;                              // Ambient temperature
+  std::vector<double> T, lam, nu, Pr;     // Table
+  gsl_spline *sp[3];                      // Splines of Prop
+
+public:
+  EnvModel(double t_amb_C, const std::string &path);
+  ~EnvModel();
+
+  EnvModel(const EnvModel&) = delete;
+  EnvModel& operator=(const EnvModel&) = delete;
+
+  double getTa() const { return Ta; }
+  double eval(Prop p, double T_, gsl_interp_accel *acc) const;
+  double deriv(Prop p, double T_, gsl_interp_accel *acc) const;
+  double prop(Prop p, double T_, gsl_interp_accel *acc) const;
+  template <size_t N>
+  Dual<N> prop(Prop p, const Dual<N> &T_, gsl_interp_accel *acc) const;
+
+  // Natural convection of the horizontal cylinder of the diameter D
+  double grPr(double th, double D, gsl_interp_accel *acc) const;
+  double alphaConv(double th, double D, gsl_interp_accel *acc) const;
+  double alphaSum(double th, double D, double eps, gsl_interp_accel *acc) const;
+
+  template <class Real>
+  Real grPr(const Real &th, double T_amb, const Real &D,
+            gsl_interp_accel *acc) const;
+  template <class Real>
+  Real alphaConv(const Real &th, double T_amb, const Real &D, double v_air,
+                 gsl_interp_accel *acc) const;
+  template <class Real>
+  static Real alphaRad(const Real &th, double T_amb, const Real &eps);
+
+  friend std::ostream& operator<<(std::ostream &os, const EnvModel &e);
+};
+
+
+template <size_t N>
+Dual<N> EnvModel::prop(Prop p, const Dual<N> &T_, gsl_interp_accel *acc) const
+{
+  return chainRule(eval(p, T_.v, acc), deriv(p, T_.v, acc), T_);
+}
+
+
+template <class Real>
+Real EnvModel::grPr(const Real &th, double T_amb, const Real &D,
+                    gsl_interp_accel *acc) const
+{
+  // Properties of the air are taken at the mean temperature
+
+  Real T_ = 0.5 * (th + T_amb);
+  Real Gr = g * (th - T_amb) / T_ * pow(D, 3.0)
+            / pow(prop(ENV_NU, T_, acc), 2.0);
+  return Gr * prop(ENV_PR, T_, acc);
+}
+
+
+template <class Real>
+Real EnvModel::alphaConv(const Real &th, double T_amb, const Real &D,
+                         double v_air, gsl_interp_accel *acc) const
+{
+  /*
+   * Natural convection; with the forced flow of the velocity v_air
+   * the mixed convection Nu^3 = Nu_natural^3 + Nu_forced^3.
+  */
+
+  Real T_ = 0.5 * (th + T_amb);
+  Real Nu = horizCylNu(grPr(th, T_amb, D, acc));
+  if (v_air > EPS)
+  {
+    Real Nu_f = crossCylNu(v_air * D / prop(ENV_NU, T_, acc),
+                           prop(ENV_PR, T_, acc));
+    Nu = cbrt(Nu * Nu * Nu + Nu_f * Nu_f * Nu_f);
+  }
+  return prop(ENV_LAMBDA, T_, acc) * Nu / D;
+}
+
+
+template <class Real>
+Real EnvModel::alphaRad(const Real &th, double T_amb, const Real &eps)
+{
+  // (th^4 - Ta^4) / (th - Ta) without the division (th may be equal to Ta)
+  return C * 1e-8 * eps * (th * th + T_amb * T_amb) * (th + T_amb);
+}
+
+
+#endif // ENV_MODEL_H
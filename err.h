@@ -14,10 +14,6 @@ struct Error
   }
 
   Error() {}
-  ~Error()
-  {
-    mess.~basic_string();
-  }
 };
 
 
@@ -0,0 +1,185 @@
+#include "events.h"
+#include "types.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+size_t EventEngine::add(const string &name, EventProbe p, double level_C,
+                        EventCross c, double r)
+{
+  // Returns the index of the event
+
+  if (level_C < -T_ABS)
+    throw err.sendEx("level is less than absolute 0");
+  if (p == PROBE_POINT && r < 0.0)
+    throw err.sendEx("radius of the probe must be >= 0");
+  events.push_back(SolveEvent(name, p, r, level_C + T_ABS, c));
+  return events.size() - 1;
+}
+
+
+void EventEngine::rearm()
+{
+  // All the events may fire again (e.g. after the solver's reset())
+
+  for (size_t k = 0; k < events.size(); ++k)
+    events[k].is_fired = false;
+}
+
+
+void EventEngine::restore(size_t k, bool fired, double t)
+{
+  // Fired state of the event (restart from a checkpoint)
+
+  if (k >= events.size())
+    throw err.sendEx("no such event");
+  events[k].is_fired = fired;
+  events[k].time = t;
+}
+
+
+void EventEngine::start(double t, const double *r, const double *th, size_t n)
+{
+  // Grid of the solution and its first layer (r - common coordinates)
+
+  if (events.empty())
+    throw err.sendEx("events are not added");
+  if (n < 2)
+    throw err.sendEx("grid must have 2 nodes at least");
+
+  node.resize(events.size());
+  w.resize(events.size());
+  is_reduce = false;
+  for (size_t k = 0; k < events.size(); ++k)
+  {
+    if (events[k].probe != PROBE_POINT)
+    {
+      is_reduce = true;
+      continue;
+    }
+    double rk = events[k].r;
+    if (rk < r[0] - EPS || rk > r[n - 1] + EPS)
+      throw err.sendEx("radius of the probe is out of the walls");
+    size_t i = upper_bound(r, r + n, rk) - r;
+    i = (i == 0) ? 0 : min(i - 1, n - 2);
+    node[k] = i;
+    w[k] = max(0.0, min(1.0, (rk - r[i]) / (r[i + 1] - r[i])));
+  }
+
+  // Trapezoidal weights of the integral of T r dr
+  vol.assign(n, 0.0);
+  double sum = 0.0;
+  for (size_t i = 0; i + 1 < n; ++i)
+  {
+    double h = r[i + 1] - r[i];
+    vol[i] += 0.5 * h * r[i];
+    vol[i + 1] += 0.5 * h * r[i + 1];
+    sum += 0.5 * h * (r[i] + r[i + 1]);
+  }
+  for (size_t i = 0; i < n; ++i)
+    vol[i] /= sum;
+
+  double red[3];
+  if (is_reduce)
+    reduce(th, n, red);
+  for (size_t k = 0; k < events.size(); ++k)
+    events[k].prev = probeValue(k, th, n, red);
+  tPrev = t;
+}
+
+
+void EventEngine::check(double t, const double *th, size_t n)
+{
+  double red[3];
+  if (is_reduce)
+    reduce(th, n, red);
+
+  for (size_t k = 0; k < events.size(); ++k)
+  {
+    SolveEvent &e = events[k];
+    double v = probeValue(k, th, n, red);
+    if (!e.is_fired)
+    {
+      bool is_down = e.prev > e.level && v <= e.level;
+      bool is_up = e.prev < e.level && v >= e.level;
+      if ((is_down && e.cross != CROSS_UP) || (is_up && e.cross != CROSS_DOWN))
+      {
+        e.is_fired = true;
+        e.time = tPrev + (t - tPrev) * (e.level - e.prev) / (v - e.prev);
+      }
+    }
+    e.prev = v;
+  }
+  tPrev = t;
+}
+
+
+bool EventEngine::allFired() const
+{
+  for (size_t k = 0; k < events.size(); ++k)
+    if (!events[k].is_fired)
+      return false;
+  return true;
+}
+
+
+const SolveEvent& EventEngine::get(size_t k) const
+{
+  if (k >= events.size())
+    throw err.sendEx("no such event");
+  return events[k];
+}
+
+
+void EventEngine::writeReport(ostream &os) const
+{
+  os << "\t..... EVENTS .....\n"
+     << "\tname\tlevel, C\ttime, s\n";
+  for (size_t k = 0; k < events.size(); ++k)
+  {
+    const SolveEvent &e = events[k];
+    os << '\t' << e.name << '\t' << e.level - T_ABS << '\t';
+    if (e.is_fired)
+      os << e.time << '\n';
+    else
+      os << "not fired\n";
+  }
+  os << '\n';
+}
+
+
+double EventEngine::probeValue(size_t k, const double *th, size_t,
+                               const double *red) const
+{
+  switch (events[k].probe)
+  {
+  case PROBE_POINT:
+    return th[node[k]] + w[k] * (th[node[k] + 1] - th[node[k]]);
+  case PROBE_MIN:
+    return red[0];
+  case PROBE_MAX:
+    return red[1];
+  default:
+    return red[2];
+  }
+}
+
+
+void EventEngine::reduce(const double *th, size_t n, double *red) const
+{
+  // red: min, max, mean
+
+  red[0] = red[1] = th[0];
+  red[2] = 0.0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (th[i] < red[0])
+      red[0] = th[i];
+    if (th[i] > red[1])
+      red[1] = th[i];
+    red[2] += vol[i] * th[i];
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "err.h"
+
+
+// *** Events of the solution ***
+enum EventProbe
+{
+  PROBE_POINT,      // Temperature at the radius r (interpolated)
+  PROBE_MIN,        // Min over the field
+  PROBE_MAX,        // Max over the field
+  PROBE_MEAN        // Mean over the cross-section (weighted by r dr)
+};
+
+
+enum EventCross { CROSS_DOWN, CROSS_UP, CROSS_ANY };
+
+
+struct SolveEvent
+{
+  std::string name;
+  EventProbe probe;
+  double r;             // Radius of PROBE_POINT
+  double level;         // Temperature, K
+  EventCross cross;
+
+  bool is_fired;
+  double time;          // Crossing time (interpolated between the layers)
+  double prev;          // Probe's value on the previous layer
+
+  SolveEvent(const std::string &n, EventProbe p, double r_, double lvl,
+             EventCross c) :
+    name(n), probe(p), r(r_), level(lvl), cross(c),
+    is_fired(false), time(0.0), prev(0.0) {}
+};
+
+
+/*
+ * Conditions checked on every time layer of the solution.
+ * An event fires once, when its probe crosses the level;
+ * the solution attached to the engine stops when all the events are fired
+ * (or at its time limit), so one run gives all the crossing times.
+*/
+class EventEngine
+{
+private:
+  mutable Error err;
+
+  std::vector<SolveEvent> events;
+  std::vector<size_t> node;       // Left node of the probe's radius
+  std::vector<double> w;          // Weight of the right node
+  std::vector<double> vol;        // Weights of the mean
+  double tPrev;
+  bool is_reduce;                 // Are min, max or mean needed
+
+public:
+  EventEngine() : tPrev(0.0), is_reduce(false) {}
+
+  size_t add(const std::string &name, EventProbe p, double level_C,
+             EventCross c = CROSS_DOWN, double r = 0.0);
+  void rearm();
+  void restore(size_t k, bool fired, double t);
+
+  void start(double t, const double *r, const double *th, size_t n);
+  void check(double t, const double *th, size_t n);
+
+  bool allFired() const;
+  size_t size() const { return events.size(); }
+  const SolveEvent& get(size_t k) const;
+  void writeReport(std::ostream &os) const;
+
+private:
+  double probeValue(size_t k, const double *th, size_t n,
+                    const double *red) const;
+  void reduce(const double *th, size_t n, double *red) const;
+};
+// *** END OF Events of the solution ***
+
+
+#endif // EVENTS_H
@@ -0,0 +1,199 @@
+#include "heat_case.h"
+#include "result_cache.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+// *** HeatCase ***
+void HeatCase::setup(ImplicitDiffSchemeCyl &solver) const
+{
+  StartConds s = sc;
+  s.setGeometry(walls, sc.H);
+
+  solver.setWalls(walls);
+  solver.setFirstBound(bound1);
+  solver.setSecondBound(bound2);
+  solver.setStartConds(s);
+  solver.setEnvironment(Ta_C, envPath);
+  solver.setResultsPath("", "");
+  solver.setMaxTime(t_max);
+  if (alphaTables)
+    solver.setAlphaTable(alphaTables->get(envPath, Ta_C, 2.0 * walls.back().r2));
+  else
+    solver.setAlphaTable(nullptr);
+  solver.setEnergyAudit(maxDrift > 0.0, maxDrift);
+}
+
+
+void HeatCase::solve(vector<double> &t, vector<double> &Tw_C) const
+{
+  ImplicitDiffSchemeCyl solver;
+  solve(t, Tw_C, solver);
+}
+
+
+void HeatCase::solve(vector<double> &t, vector<double> &Tw_C,
+                     ImplicitDiffSchemeCyl &solver) const
+{
+  /*
+   * Headless solution, the results aren't written to the files.
+   * The solver may be reused for many cases: only the parts
+   * changed since its last solution are rebuilt.
+  */
+
+  if (cache && cache->find(*this, t, Tw_C))
+    return;
+
+  setup(solver);
+  solver.solve(dt, delta_T);
+
+  t = solver.getTime();
+  Tw_C = solver.getTw();
+  for (size_t i = 0; i < Tw_C.size(); ++i)
+    Tw_C[i] -= T_ABS;
+
+  if (cache)
+    cache->store(*this, t, Tw_C);
+}
+
+
+double HeatCase::thresholdTime(const vector<double> &t,
+                               const vector<double> &Tw_C) const
+{
+  // Time Tw falls to Ta + delta_T; the last time if it isn't reached
+
+  double T_end = Ta_C + delta_T;
+  size_t n = t.size();
+  if (n == 0)
+    return sc.time;
+  if (n < 2 || Tw_C[n - 1] > T_end)
+    return t[n - 1];
+  return t[n - 2] + (Tw_C[n - 2] - T_end) / (Tw_C[n - 2] - Tw_C[n - 1])
+                    * (t[n - 1] - t[n - 2]);
+}
+// *** END OF HeatCase ***
+
+
+// *** CaseParam ***
+static void moveRadius(Walls &ws, size_t wi, double R)
+{
+  /*
+   * The grids of the wall and the next one are stretched linearly,
+   * so the grading is kept.
+  */
+
+  Error err;
+  Wall &w = ws[wi];
+  if (R < w.r1 + EPS || (wi + 1 < ws.size() && R > ws[wi + 1].r2 - EPS))
+    throw err.sendEx("radius is out of the neighbouring walls");
+
+  if (w.is_grid)
+  {
+    double k = (R - w.r1) / (w.r2 - w.r1);
+    for (size_t i = 1; i < w.N; ++i)
+      w.r[i] = w.r1 + (w.r[i] - w.r1) * k;
+    w.r[w.N - 1] = R;
+  }
+  w.r2 = R;
+  w.step = (w.r2 - w.r1) / (w.N - 1);
+
+  if (wi + 1 == ws.size())
+    return;
+
+  Wall &nw = ws[wi + 1];
+  if (nw.is_grid)
+  {
+    double k = (nw.r2 - R) / (nw.r2 - nw.r1);
+    for (size_t i = 0; i < nw.N - 1; ++i)
+      nw.r[i] = nw.r2 - (nw.r2 - nw.r[i]) * k;
+    nw.r[0] = R;
+  }
+  nw.r1 = R;
+  nw.step = (nw.r2 - nw.r1) / (nw.N - 1);
+}
+
+
+double CaseParam::get(const HeatCase &hc) const
+{
+  Error err;
+  if (kind == PAR_ALPHA)
+    return hc.bound2.alpha;
+
+  if (wall >= hc.walls.size())
+    throw err.sendEx("wall of the parameter doesn't exist");
+  const Wall &w = hc.walls[wall];
+  if ((kind == PAR_LAMBDA || kind == PAR_C) && index >= w.dataSize)
+    throw err.sendEx("table index of the parameter is out of the table");
+
+  switch (kind)
+  {
+  case PAR_EPSILON:
+    return w.epsilon;
+  case PAR_RHO:
+    return w.rho;
+  case PAR_LAMBDA:
+    return w.lambda[index];
+  case PAR_RADIUS:
+    return w.r2;
+  default:
+    return w.c[index];
+  }
+}
+
+
+void CaseParam::set(HeatCase &hc, double v) const
+{
+  Error err;
+  v = std::max(min, std::min(max, v));
+
+  if (kind == PAR_ALPHA)
+  {
+    hc.bound2.alpha = v;
+    return;
+  }
+
+  if (wall >= hc.walls.size())
+    throw err.sendEx("wall of the parameter doesn't exist");
+  Wall &w = hc.walls[wall];
+  if ((kind == PAR_LAMBDA || kind == PAR_C) && index >= w.dataSize)
+    throw err.sendEx("table index of the parameter is out of the table");
+
+  switch (kind)
+  {
+  case PAR_EPSILON:
+    w.setBlackness(v);
+    break;
+  case PAR_RHO:
+    w.setDens(v);
+    break;
+  case PAR_LAMBDA:
+    w.lambda[index] = v;
+    break;
+  case PAR_RADIUS:
+    moveRadius(hc.walls, wall, v);
+    break;
+  default:
+    w.c[index] = v;
+  }
+}
+// *** END OF CaseParam ***
+
+
+double interpSeries(const vector<double> &t, const vector<double> &T, double tv)
+{
+  // Series is extended by its end values
+
+  if (t.empty())
+    return 0.0;
+  if (tv <= t.front())
+    return T.front();
+  if (tv >= t.back())
+    return T.back();
+
+  size_t i = upper_bound(t.begin(), t.end(), tv) - t.begin();
+  double w = (tv - t[i - 1]) / (t[i] - t[i - 1]);
+  return T[i - 1] + w * (T[i] - T[i - 1]);
+}
@@ -0,0 +1,76 @@
+#ifndef HEAT_CASE_H
+#define HEAT_CASE_H
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "implicit_diff_scheme_cyl.h"
+
+
+class ResultCache;
+
+// *** Full input of one solution (to build the solvers from) ***
+struct HeatCase
+{
+  Walls walls;                // Walls with the grids set
+  BoundCond bound1, bound2;   // Left & right boundary conditions
+  StartConds sc;              // Start conditions (sc.H is used)
+  double Ta_C;                // Ambient temperature, C
+  std::string envPath;        // Environment table
+  double dt;                  // Time step
+  double delta_T;             // Termination: Tw < Ta + delta_T
+  double t_max;               // Termination: time limit
+  ResultCache *cache;         // Results of the solved cases (may be null)
+  AlphaTables *alphaTables;   // Shared alpha_conv tables (may be null)
+  double maxDrift;            // Abort on the energy balance drift (0 - off)
+
+  HeatCase() :
+    sc(0.0), Ta_C(0.0), dt(1.0), delta_T(0.0), t_max(HUGE_VAL),
+    cache(nullptr), alphaTables(nullptr), maxDrift(0.0) {}
+
+  void setup(ImplicitDiffSchemeCyl &solver) const;
+  void solve(std::vector<double> &t, std::vector<double> &Tw_C) const;
+  void solve(std::vector<double> &t, std::vector<double> &Tw_C,
+             ImplicitDiffSchemeCyl &solver) const;
+  double thresholdTime(const std::vector<double> &t,
+                       const std::vector<double> &Tw_C) const;
+};
+// *** END OF HeatCase ***
+
+
+// *** Parameters of the case (for estimation, sensitivities etc.) ***
+enum ParamKind
+{
+  PAR_EPSILON,    // Wall blackness
+  PAR_RHO,        // Wall density
+  PAR_LAMBDA,     // Wall lambda(T) table value
+  PAR_C,          // Wall c(T) table value
+  PAR_ALPHA,      // Heat emission coeff of the second bound (type 3)
+  PAR_RADIUS      // Wall outer radius (the inner radius of the next wall)
+};
+
+
+struct CaseParam
+{
+  ParamKind kind;
+  size_t wall;          // Index of the wall (for the wall's parameters)
+  size_t index;         // Index in the table (for PAR_LAMBDA and PAR_C)
+  double min, max;      // Bounds of the value
+
+  CaseParam(ParamKind k, size_t w = 0, size_t i = 0,
+            double mn = -HUGE_VAL, double mx = HUGE_VAL) :
+    kind(k), wall(w), index(i), min(mn), max(mx) {}
+
+  double get(const HeatCase &hc) const;
+  void set(HeatCase &hc, double v) const;
+};
+// *** END OF CaseParam ***
+
+
+// Linear interpolation of the series (t, T) at the time tv
+double interpSeries(const std::vector<double> &t, const std::vector<double> &T,
+                    double tv);
+
+
+#endif // HEAT_CASE_H
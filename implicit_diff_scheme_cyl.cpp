@@ -1,88 +1,195 @@
 #include "implicit_diff_scheme_cyl.h"
+#include "mapped_series.h"
+#include "scheme_coeffs.h"
+#include "sensitivity.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 
 using namespace std;
 
 
+#define CKPT_MAGIC "NSHK"
+#define CKPT_VERSION 2
+
+
 ImplicitDiffSchemeCyl::ImplicitDiffSchemeCyl() :
   is_walls(false), is_startConds(false),
   is_bound1(false), is_bound2(false), is_env(false),
-  totalN(0), wallsN(0), t_ind(0), alphaS(0.0)
+  is_frozen(false), is_dd(false),
+  frozenTol(0.0), is_refreshed(false),
+  totalN(0), wallsN(0), env(nullptr), envTa(0.0), time(0.0),
+  is_cancel(false), is_cancelled(false), progressQ(nullptr), progressEvery(1),
+  resPath(RES_PATH), resBinPath(RES_BIN_PATH), timeMax(HUGE_VAL),
+  events(nullptr),
+  ckptEvery(0),
+  is_gridChanged(true), is_tablesChanged(true),
+  lInterpN(0), startTime(0.0), alphaTab(nullptr),
+  ambient(nullptr), airVel(0.0),
+  is_audit(false), driftMax(0.0), enRef(0.0),
+  enStored(0.0), enLost(0.0), enDrift(0.0),
+  t_ind(0), alphaS(0.0)
 {
   lAcc = gsl_interp_accel_alloc();
   sAcc = gsl_interp_accel_alloc();
-
-  lInterp = gsl_spline_eval;
-  sInterp = gsl_spline_eval;
+  tAcc = gsl_interp_accel_alloc();
+
+  a = A = b = B = G = nullptr;
+  r = nullptr;
+  lLam = l_c = nullptr;
+  wAcc = nullptr;
+
+  lsType = TRIDIAG_THOMAS;
+  lsActive = TRIDIAG_THOMAS;
+  ls = nullptr;
+
+  propsEval = PROPS_SPLINE;
+  precision = PRECISION_DOUBLE;
+  refineN = 0;
+  mixDt = 0.0;
+  stepFn = nullptr;
+  boundFn = nullptr;
+  auditFn = nullptr;
+  kh1 = kh2 = 0.0;
 }
 
 
 ImplicitDiffSchemeCyl::~ImplicitDiffSchemeCyl()
 {
-  delete [] a;
-  delete [] b;
-
-  // Clear interpolation
-  for (size_t i = 0; i < wallsN; ++i)
-  {
-    gsl_spline_free(lLam[i]);
-    gsl_spline_free(l_c[i]);
-  }
-  delete [] lLam;
-  delete [] l_c;
-
-  gsl_spline_free(sEnv_c);
-  gsl_spline_free(sEnv_Pr);
-  gsl_spline_free(sEnv_mu);
-  gsl_spline_free(sEnv_nu);
-  gsl_spline_free(sEnv_lam);
-  gsl_spline_free(sEnv_rho);
-  gsl_spline_free(sEnv_a);
+  freeDF();
+  freeLInterp();
+  delete ls;
+  delete env;
 
   gsl_interp_accel_free(lAcc);
   gsl_interp_accel_free(sAcc);
-
-  delete [] r;
+  gsl_interp_accel_free(tAcc);
 }
 
 
 void ImplicitDiffSchemeCyl::setWalls(const Walls &ws)
 {
-  for (WallCItr i = ws.begin(); i != ws.end(); ++i)
+  /*
+   * Replaces the walls. The grid-dependent buffers and the walls' splines
+   * are rebuilt by the next solve() only if the grids or the tables
+   * are changed (rho and epsilon may change freely).
+   * Start conditions must be set again if the grid is changed.
+  */
+
+  if (ws.empty())
+    throw err.sendEx("walls are empty");
+
+  bool sameGrid = is_walls && ws.size() == walls.size();
+  bool sameTables = sameGrid;
+  for (size_t i = 0; sameGrid && i < ws.size(); ++i)
   {
-    walls.push_back(*i);
-    wallsN++;
-    totalN += i->N;
+    const Wall &w = ws[i];
+    const Wall &o = walls[i];
+    if (w.N != o.N || !w.is_grid || !o.is_grid)
+    {
+      sameGrid = sameTables = false;
+      break;
+    }
+    for (size_t j = 0; j < w.N; ++j)
+      if (w.r[j] != o.r[j])
+        sameGrid = false;
+
+    if (w.dataSize != o.dataSize)
+      sameTables = false;
+    for (size_t j = 0; sameTables && j < w.dataSize; ++j)
+      if (w.T_table[j] != o.T_table[j] || w.lambda[j] != o.lambda[j]
+          || w.c[j] != o.c[j])
+        sameTables = false;
   }
+
+  walls.clear();
+  walls.insert(walls.end(), ws.begin(), ws.end());
+  wallsN = walls.size();
+  totalN = 0;
+  for (WallCItr i = walls.begin(); i != walls.end(); ++i)
+    totalN += i->N;
   totalN -= wallsN - 1;
   is_walls = true;
+
+  if (!sameGrid)
+  {
+    is_gridChanged = true;
+    is_startConds = false;
+  }
+  if (!sameTables)
+    is_tablesChanged = true;
 }
 
 
 void ImplicitDiffSchemeCyl::setStartConds(const StartConds &sc)
 {
+  if (!is_walls)
+    throw err.sendEx("walls must be set before the start conditions");
+
   time = sc.time;
   H = sc.H;
   D = sc.D;
 
   T0 = sc.T0;
+  if (T0 < 0.0)
+    throw err.sendEx("invalid temperature (less than absolute 0)");
 
-  Tw_vec.push_back(T0);
-  time_vec.push_back(time);
-
-  setStartTemperature();
+  setStartTemperature(vector<double>(totalN, T0));
 
   is_startConds = true;
 }
 
 
+void ImplicitDiffSchemeCyl::setStartProfile(const vector<double> &r_prof,
+                                            const vector<double> &T_C)
+{
+  /*
+   * Non-uniform start temperature T(r) (warm start), replaces T0.
+   * The profile is interpolated linearly onto the grid,
+   * out of its ends it's extended by the end values.
+  */
+
+  if (!is_startConds)
+    throw err.sendEx("start conditions must be set before the profile");
+  if (r_prof.size() != T_C.size() || r_prof.empty())
+    throw err.sendEx("size of the profile's radii != size of temperatures");
+  for (size_t i = 1; i < r_prof.size(); ++i)
+    if (r_prof[i] <= r_prof[i - 1])
+      throw err.sendEx("profile's radii must increase");
+
+  vector<double> rc = calcGridCoords();
+  vector<double> th(totalN);
+  for (size_t i = 0; i < totalN; ++i)
+  {
+    size_t k = upper_bound(r_prof.begin(), r_prof.end(), rc[i]) - r_prof.begin();
+    if (k == 0)
+      th[i] = T_C.front();
+    else if (k == r_prof.size())
+      th[i] = T_C.back();
+    else
+      th[i] = T_C[k - 1] + (T_C[k] - T_C[k - 1]) * (rc[i] - r_prof[k - 1])
+                           / (r_prof[k] - r_prof[k - 1]);
+    th[i] += T_ABS;
+    if (th[i] < 0.0)
+      throw err.sendEx("invalid temperature (less than absolute 0)");
+  }
+
+  setStartTemperature(th);
+}
+
+
 void ImplicitDiffSchemeCyl::setFirstBound(const BoundCond &bc)
 {
-  if (bc.type != 2)
+  if (bc.type < 1 || bc.type > 3)
     throw err.sendEx("this condition type is not supported for the first bound");
+  if (bc.type == 3 && bc.alpha < EPS)
+    throw err.sendEx("heat emission coeff must be set for the first bound");
   bound1 = bc;
   is_bound1 = true;
 }
@@ -90,8 +197,8 @@ void ImplicitDiffSchemeCyl::setFirstBound(const BoundCond &bc)
 
 void ImplicitDiffSchemeCyl::setSecondBound(const BoundCond &bc)
 {
-  if (bc.type != 3)
-    throw err.sendEx("this condition type is not supported for the first bound");
+  if (bc.type < 1 || bc.type > 4)
+    throw err.sendEx("this condition type is not supported for the second bound");
   bound2 = bc;
   is_bound2 = true;
 }
@@ -99,384 +206,1659 @@ void ImplicitDiffSchemeCyl::setSecondBound(const BoundCond &bc)
 
 void ImplicitDiffSchemeCyl::setEnvironment(double t_amb_C, const string &src_path)
 {
+  // The table is read (and its splines are rebuilt) only if the path is new
+
   if (t_amb_C < -T_ABS)
     throw err.sendEx("temperature is set less than absolute 0");
 
-  fstream file(src_path.c_str(), ios_base::in);
-  if (!file.is_open())
-    throw err.sendEx("file is not opened");
-  file.close();
+  envTa = t_amb_C + T_ABS;
+  if (is_env && src_path == envPath)
+    return;
 
-  env.Ta = t_amb_C + T_ABS;
-  env.dataSize = calcEnvSize(src_path);
-  giveMemEnv();
-  readEnvData(src_path);
+  EnvModel *e = new EnvModel(t_amb_C, src_path);
+  delete env;
+  env = e;
+  envPath = src_path;
 
   is_env = true;
-
-  cout << env << '\n';
 }
 
-void ImplicitDiffSchemeCyl::solve(double dt, double delta_T)
+
+void ImplicitDiffSchemeCyl::setFrozenCoeffs(double delta_T)
 {
   /*
-   * This is the main solver's function.
+   * Keep the assembled and factored system (a, A, B, alphaS)
+   * until the temperature changes by more than delta_T
+   * since the last refresh. Between refreshes only
+   * the right-hand side (b) and back substitution are computed.
   */
 
-  // Flags checking
-  if (!is_env)
-    throw err.sendEx("environment is not initialized");
-  if (!is_walls)
-    throw err.sendEx("walls are not initialized");
-  if (!is_bound1)
-    throw err.sendEx("first boundary condition is not initialized");
-  if (!is_bound2)
-    throw err.sendEx("second boundary condition is not initialized");
-  if (!is_startConds)
-    throw err.sendEx("start conditions are not initialized");
-  // Input checking
   if (delta_T < 0.0)
-    throw err.sendEx("temperature is set less than ambient temperature");
-  if (dt < 0.0)
-    throw err.sendEx("time step must be > 0");
+    throw err.sendEx("frozen coefficients tolerance must be >= 0");
+  frozenTol = delta_T;
+  is_frozen = true;
+}
 
-  setCommonCoords();
-  giveMemDF();
-  prepareLInterp();
-  prepareSInterp();
 
-  double T_end = env.Ta + delta_T;
+void ImplicitDiffSchemeCyl::setDomainDecomp(bool on)
+{
+  /*
+   * Solve every wall's block on its own thread.
+   * The blocks are coupled through the small interface system
+   * of the joints and the outer bounds (partitioned Thomas).
+  */
 
-  while (*(Tw_vec.end() - 1) > T_end)
-  {
-    calcDF(dt);
-    calcTemperature();
+  is_dd = on;
+}
 
-    time += dt;
-    time_vec.push_back(time);
-    t_ind++;
-  }
 
-  writeResultsFile(RES_PATH);
+void ImplicitDiffSchemeCyl::setLinearSolver(TridiagType type)
+{
+  /*
+   * TRIDIAG_THOMAS is the built-in sweep (default),
+   * TRIDIAG_CR is the multithreaded cyclic reduction,
+   * TRIDIAG_AUTO chooses CR for totalN >= tridiagCrossover()
+   * (see calibrateTridiagCrossover() to measure it on this machine).
+  */
+
+  lsType = type;
 }
 
 
-void ImplicitDiffSchemeCyl::showWalls() const
+void ImplicitDiffSchemeCyl::setPropsEval(PropsEval pe)
 {
-  if (!walls.empty())
-  {
-    cout << "Amount of walls: " << wallsN << '\n';
-    for (WallCItr i = walls.begin(); i != walls.end(); ++i)
-      cout << *i;
-  }
+  /*
+   * PROPS_SPLINE evaluates lambda(T) and c(T) by GSL linear splines,
+   * PROPS_TABLE by the inline table lookup (extrapolates beyond the table).
+  */
+
+  propsEval = pe;
 }
 
 
-// *** PRIVATE ***
-void ImplicitDiffSchemeCyl::setStartTemperature()
+void ImplicitDiffSchemeCyl::setPrecision(Precision p, size_t refine)
 {
-  // Start temperature destribution
+  /*
+   * PRECISION_MIXED assembles the coefficients and runs the sweep
+   * in float for the increment of the field, the field and the residuals
+   * stay double (refine - additional solves for the residual's correction).
+   * Only the serial sweep without the frozen coefficients supports it.
+  */
 
-  if (T0 < 0.0)
-    throw err.sendEx("invalid temperature (less than absolute 0)");
+  precision = p;
+  refineN = refine;
+}
 
-  theta_buf.resize(totalN);
-  for (size_t i = 0; i < totalN; ++i)
-    theta_buf[i] = T0;
-  theta.push_back(theta_buf);
 
-  for (WallItr itr = walls.begin(); itr != walls.end(); ++itr)
-  {
-    if (itr->is_T)
-      throw err.sendEx("T(tau) was already initialized");
+void ImplicitDiffSchemeCyl::setResultsPath(const string &path,
+                                           const string &bin_path)
+{
+  // Empty paths turn off the files (e.g. for the parallel solutions)
 
-    for (size_t i = 0; i < itr->N; ++i)
-      itr->T[i] = T0;
-    itr->is_T = true;
-  }
+  resPath = path;
+  resBinPath = bin_path;
 }
 
 
-void ImplicitDiffSchemeCyl::setCommonCoords()
+void ImplicitDiffSchemeCyl::setMaxTime(double t_max)
 {
-  r = new double[totalN];
+  // Solution also stops at the time t_max
 
-  size_t k = 0;
-  for (size_t i = 0; i < wallsN; ++i)
-    for (size_t j = (i == 0) ? 0 : 1; j < walls[i].N; ++j)
-    {
-      r[k] = walls[i].r[j];
-      k++;
-    }
+  if (t_max < 0.0)
+    throw err.sendEx("time limit must be > 0");
+  timeMax = t_max;
 }
 
 
-size_t ImplicitDiffSchemeCyl::calcEnvSize(const string &path)
+void ImplicitDiffSchemeCyl::setEvents(EventEngine *e)
 {
-  size_t s = 0;
-  fstream f(path.c_str(), ios_base::in);
-  string buf;
-
-  while (!f.eof())
-  {
-    for (int i = 0; i < 8; ++i)
-      f >> buf;
-    s++;
-  }
+  /*
+   * With the events the solution stops when all of them are fired
+   * or at the time limit (must be set), instead of Tw < Ta + delta_T.
+   * Null returns to the Tw criterion.
+  */
 
-  f.close();
-  return --s;
+  events = e;
 }
 
 
-void ImplicitDiffSchemeCyl::giveMemEnv()
+void ImplicitDiffSchemeCyl::setAlphaTable(const AlphaTable *table)
 {
-  env.T = new double[env.dataSize];
-  env.a = new double[env.dataSize];
-  env.c = new double[env.dataSize];
-  env.Pr = new double[env.dataSize];
-  env.mu = new double[env.dataSize];
-  env.nu = new double[env.dataSize];
-  env.rho = new double[env.dataSize];
-  env.lambda = new double[env.dataSize];
+  /*
+   * alpha_conv of the natural convection is looked up in the table
+   * (within its range, else it's calculated). The table must serve
+   * the solver's environment and outer diameter (checked by solve()).
+  */
+
+  alphaTab = table;
+  alphaKeep.reset();
 }
 
 
-void ImplicitDiffSchemeCyl::readEnvData(const string &path)
+void ImplicitDiffSchemeCyl::setAlphaTable(shared_ptr<const AlphaTable> table)
 {
-  fstream f(path.c_str(), ios_base::in);
+  // Shared table (e.g. of AlphaTables): the solver keeps it alive
 
-  for (size_t i = 0; i < env.dataSize; ++i)
-  {
-    f >> env.T[i] >> env.lambda[i]
-      >> env.rho[i] >> env.c[i]
-      >> env.a[i] >> env.nu[i]
-      >> env.mu[i] >> env.Pr[i];
-    env.T[i] += T_ABS;
-  }
-
-  f.close();
+  alphaTab = table.get();
+  alphaKeep = table;
 }
 
 
-void ImplicitDiffSchemeCyl::prepareLInterp()
+void ImplicitDiffSchemeCyl::setAmbientStream(AmbientStream *s)
 {
-  // Function uses linear interpolation for materials
-  // because temperature changes in narrow interval
+  /*
+   * T_amb(t) and the air velocity of the stream replace the constant
+   * ambient temperature of the type 3 bound (and of the environment)
+   * at every step; the alpha table isn't used with the stream.
+   * setEnvironment must be called again to return to the constant Ta.
+  */
 
-  lLam = new gsl_spline*[wallsN];
-  l_c = new gsl_spline*[wallsN];
-  for (size_t i = 0; i < wallsN; ++i)
-  {
-    // lambda
-    lLam[i] = gsl_spline_alloc(gsl_interp_linear, walls[i].dataSize);
-    gsl_spline_init(lLam[i],
-                    walls[i].T_table, walls[i].lambda,
-                    walls[i].dataSize);
-    // c
-    l_c[i] = gsl_spline_alloc(gsl_interp_linear, walls[i].dataSize);
-    gsl_spline_init(l_c[i],
-                    walls[i].T_table, walls[i].c,
-                    walls[i].dataSize);
-  }
+  ambient = s;
+  airVel = 0.0;
 }
 
 
-void ImplicitDiffSchemeCyl::prepareSInterp()
+void ImplicitDiffSchemeCyl::setEnergyAudit(bool on, double max_drift)
 {
-  sEnv_c = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_Pr = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_mu = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_nu = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_lam = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_rho = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
-  sEnv_a = gsl_spline_alloc(gsl_interp_akima, env.dataSize);
+  /*
+   * The audit compares the change of the stored heat with the heat
+   * crossed the bounds at every step (O(N)); the drift is their
+   * mismatch relative to the start heat above Ta. With max_drift > 0
+   * the solution is aborted (exception) when |drift| exceeds it.
+  */
 
-  gsl_spline_init(sEnv_c, env.T, env.c, env.dataSize);
-  gsl_spline_init(sEnv_Pr, env.T, env.Pr, env.dataSize);
-  gsl_spline_init(sEnv_mu, env.T, env.mu, env.dataSize);
-  gsl_spline_init(sEnv_nu, env.T, env.nu, env.dataSize);
-  gsl_spline_init(sEnv_lam, env.T, env.lambda, env.dataSize);
-  gsl_spline_init(sEnv_rho, env.T, env.rho, env.dataSize);
-  gsl_spline_init(sEnv_a, env.T, env.a, env.dataSize);
+  if (max_drift < 0.0)
+    throw err.sendEx("limit of the energy drift must be >= 0");
+  is_audit = on;
+  driftMax = max_drift;
 }
 
 
-void ImplicitDiffSchemeCyl::giveMemDF()
+void ImplicitDiffSchemeCyl::setCheckpoint(const string &path, size_t every)
 {
-  a = new double[totalN - 1];
-  A = new double[totalN - 1];
-  b = new double[totalN - 1];
-  B = new double[totalN - 1];
+  // Checkpoint is rewritten every n-th step (0 - off)
+
+  if (every > 0 && path.empty())
+    throw err.sendEx("path of the checkpoint is empty");
+  ckptPath = path;
+  ckptEvery = every;
 }
 
 
-void ImplicitDiffSchemeCyl::calcDF(double dt)
+void ImplicitDiffSchemeCyl::saveCheckpoint(const string &path) const
 {
-  setStartDF();
+  /*
+   * Binary state of the solution: header ("NSHK", version),
+   * sizes and t_ind, time, alphaS, H, D, T0, the bound rows,
+   * the energy audit's sums, grid, temperature field, the history,
+   * the frozen system (if any) and the fired events (if any),
+   * so the restarted solution continues as the uninterrupted one.
+   * The frozen system of DD and the pluggable solvers isn't saved:
+   * these combinations are rejected.
+   * The file is written under a temporary name and renamed,
+   * so the previous checkpoint survives a crash during the writing.
+  */
 
-  size_t wi = 0;
-  size_t n = walls[wi].N - 1;
+  if (!is_startConds)
+    throw err.sendEx("start conditions are not initialized");
+  bool is_frz = is_frozen && theta_frz.size() == totalN;
+  if (is_frz && (is_dd || ls))
+    throw err.sendEx("frozen system of DD or a pluggable solver isn't checkpointed");
 
-  for (size_t i = 1; i < totalN - 1; ++i)
+  string tmp = path + ".tmp";
+  fstream f(tmp.c_str(), ios_base::out | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("checkpoint file is not opened");
+
+  char head[8] = { 0 };
+  memcpy(head, CKPT_MAGIC, 4);
+  uint32_t version = CKPT_VERSION;
+  memcpy(head + 4, &version, sizeof(version));
+  f.write(head, sizeof(head));
+
+  uint64_t u[5] = { totalN, t_ind, time_vec.size(), is_frz,
+                    events ? events->size() : 0 };
+  double d[17] = { time, alphaS, H, D, T0,
+                   row1[0], row1[1], row1[2], row2[0], row2[1], row2[2],
+                   kh1, kh2, enRef, enStored, enLost, enDrift };
+  vector<double> rc = calcGridCoords();
+  f.write(reinterpret_cast<const char*>(u), sizeof(u));
+  f.write(reinterpret_cast<const char*>(d), sizeof(d));
+  f.write(reinterpret_cast<const char*>(rc.data()), totalN * sizeof(double));
+  f.write(reinterpret_cast<const char*>(theta_buf.data()), totalN * sizeof(double));
+  f.write(reinterpret_cast<const char*>(time_vec.data()),
+          time_vec.size() * sizeof(double));
+  f.write(reinterpret_cast<const char*>(Tw_vec.data()),
+          Tw_vec.size() * sizeof(double));
+  if (is_frz)
   {
-    if (i == n && wi != wallsN - 1)           // Joint case condition
-    {
-      n += walls[wi + 1].N - 1;
-      calcJointDF(dt, wi, i);
-      wi++;
-      continue;
-    }
-    calcInnerDF(dt, wi, i);
+    f.write(reinterpret_cast<const char*>(theta_frz.data()), totalN * sizeof(double));
+    // Driving factors have totalN - 1 nodes (see giveMemDF)
+    f.write(reinterpret_cast<const char*>(a), (totalN - 1) * sizeof(double));
+    f.write(reinterpret_cast<const char*>(A), (totalN - 1) * sizeof(double));
+    f.write(reinterpret_cast<const char*>(B), (totalN - 1) * sizeof(double));
+  }
+  for (size_t k = 0; k < u[4]; ++k)
+  {
+    const SolveEvent &e = events->get(k);
+    double ev[2] = { double(e.is_fired), e.time };
+    f.write(reinterpret_cast<const char*>(ev), sizeof(ev));
+  }
+
+  bool ok = f.good();
+  f.close();
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+  {
+    remove(tmp.c_str());
+    throw err.sendEx("checkpoint is not written");
   }
 }
 
 
-void ImplicitDiffSchemeCyl::setStartDF()
+void ImplicitDiffSchemeCyl::loadCheckpoint(const string &path)
 {
-  if (fabs(bound1.q - 0.0) < EPS)
+  /*
+   * Restart from the checkpoint instead of setStartConds.
+   * The walls must be the same as in the saved solution.
+  */
+
+  if (!is_walls)
+    throw err.sendEx("walls must be set before the checkpoint is loaded");
+
+  fstream f(path.c_str(), ios_base::in | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("checkpoint file is not opened");
+
+  char head[8];
+  uint32_t version;
+  f.read(head, sizeof(head));
+  memcpy(&version, head + 4, sizeof(version));
+  if (!f || memcmp(head, CKPT_MAGIC, 4) != 0 || version != CKPT_VERSION)
+    throw err.sendEx("file is not a checkpoint");
+
+  uint64_t u[5];
+  double d[17];
+  f.read(reinterpret_cast<char*>(u), sizeof(u));
+  f.read(reinterpret_cast<char*>(d), sizeof(d));
+  if (!f || u[0] != totalN)
+    throw err.sendEx("checkpoint's grid differs from the walls' grid");
+  if (u[4] != (events ? events->size() : 0))
+    throw err.sendEx("checkpoint's events differ from the set ones");
+
+  // Size of the rest by the header (the frozen system is theta_frz, a, A, B)
+  size_t frzN = u[3] ? totalN + 3 * (totalN - 1) : 0;
+  streampos pos = f.tellg();
+  f.seekg(0, ios_base::end);
+  uint64_t rest = uint64_t(f.tellg() - pos);
+  f.seekg(pos);
+  if (u[2] > rest / (2 * sizeof(double)) ||
+      rest != (2 * totalN + 2 * u[2] + frzN + 2 * u[4]) * sizeof(double))
+    throw err.sendEx("checkpoint's size doesn't match its header");
+
+  vector<double> rc(totalN), th(totalN), tv(u[2]), Tv(u[2]);
+  f.read(reinterpret_cast<char*>(rc.data()), totalN * sizeof(double));
+  f.read(reinterpret_cast<char*>(th.data()), totalN * sizeof(double));
+  f.read(reinterpret_cast<char*>(tv.data()), tv.size() * sizeof(double));
+  f.read(reinterpret_cast<char*>(Tv.data()), Tv.size() * sizeof(double));
+  vector<double> frz;
+  if (u[3])
   {
-    a[0] = 1.0;
-    b[0] = 0.0;
-    A[0] = 0.0;
-    B[0] = 0.0;
-    return;
+    frz.resize(frzN);
+    f.read(reinterpret_cast<char*>(frz.data()), frz.size() * sizeof(double));
   }
-  throw err.sendEx("program is not ready for this shit yet");
+  vector<double> ev(2 * u[4]);
+  f.read(reinterpret_cast<char*>(ev.data()), ev.size() * sizeof(double));
+  if (!f)
+    throw err.sendEx("checkpoint is truncated");
+  f.close();
+
+  vector<double> grid = calcGridCoords();
+  for (size_t i = 0; i < totalN; ++i)
+    if (fabs(grid[i] - rc[i]) > EPS)
+      throw err.sendEx("checkpoint's grid differs from the walls' grid");
+
+  time = d[0];
+  H = d[2];
+  D = d[3];
+  T0 = d[4];
+  setStartTemperature(th);
+
+  alphaS = d[1];
+  t_ind = size_t(u[1]);
+  time_vec.swap(tv);
+  Tw_vec.swap(Tv);
+  copy(d + 5, d + 8, row1);
+  copy(d + 8, d + 11, row2);
+  kh1 = d[11];
+  kh2 = d[12];
+  enRef = d[13];
+  enStored = d[14];
+  enLost = d[15];
+  enDrift = d[16];
+
+  // Frozen system is put into the driving factors by the next solve()
+  if (!frz.empty())
+    theta_frz.assign(frz.begin(), frz.begin() + totalN);
+  frzDF.assign(frz.begin() + min(frz.size(), totalN), frz.end());
+  for (size_t k = 0; k < u[4]; ++k)
+    events->restore(k, ev[2 * k] != 0.0, ev[2 * k + 1]);
+
+  is_startConds = true;
 }
 
 
-void ImplicitDiffSchemeCyl::calcJointDF(double dt, size_t wi, size_t i)
+void ImplicitDiffSchemeCyl::solve(double dt, double delta_T)
 {
-  double _a = calcJointTempCoeff(wi, i);
+  /*
+   * This is the main solver's function.
+  */
+
+  checkInit();
+  // Input checking
+  if (delta_T < 0.0)
+    throw err.sendEx("temperature is set less than ambient temperature");
+  if (dt < 0.0)
+    throw err.sendEx("time step must be > 0");
 
-  A[i] = _a * dt * (r[i] + r[i + 1]) / (r[i] * (r[i + 1] - r[i]) * (r[i + 1] - r[i - 1]));
-  B[i] = _a * dt * (r[i] + r[i - 1]) / (r[i] * (r[i] - r[i - 1]) * (r[i + 1] - r[i - 1]));
+  if (events && timeMax == HUGE_VAL)
+    throw err.sendEx("time limit must be set for the events");
 
-  a[i] = A[i] / (1.0 + A[i] + B[i] * (1.0 - a[i - 1]));
-  b[i] = theta_buf[i] / A[i] + B[i] / A[i] * a[i - 1] * b[i - 1];
-}
+  prepareSolve();
+  selectStep(dv);
 
+  if (!frzDF.empty())
+  {
+    size_t n = totalN - 1;
+    if (frzDF.size() != 3 * n)
+      throw err.sendEx("frozen system of the checkpoint doesn't fit the grid");
+    copy(frzDF.begin(), frzDF.begin() + n, a);
+    copy(frzDF.begin() + n, frzDF.begin() + 2 * n, A);
+    copy(frzDF.begin() + 2 * n, frzDF.end(), B);
+    frzDF.clear();
+  }
 
-double ImplicitDiffSchemeCyl::calcJointTempCoeff(size_t wi, size_t i)
-{
-  if (wi == wallsN - 1)
-    throw err.sendEx("the last wall doesn't have outer joint");
+  if (events)
+    events->start(time, r, theta_buf.data(), totalN);
+  if (is_audit)
+    prepareAudit();
 
-  double c1 = lInterp(l_c[wi], theta_buf[i], lAcc);
-  double c2 = lInterp(l_c[wi + 1], theta_buf[i + 1], lAcc);
+  // With the ambient stream the termination follows the current Ta
+  if (ambient)
+    applyAmbient(time);
+  double T_end = envTa + delta_T;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  is_cancelled = false;
 
-  double rho1 = walls[wi].rho;
-  double rho2 = walls[wi + 1].rho;
-  double crho_ = (c1 * rho1 * walls[wi].step + c2 * rho2 * walls[wi + 1].step)
-                 / (walls[wi].step + walls[wi + 1].step);
+  while ((events ? !events->allFired() : *(Tw_vec.end() - 1) > T_end)
+         && time < timeMax)
+  {
+    if (is_cancel.load(memory_order_relaxed))
+    {
+      is_cancelled = true;
+      break;
+    }
+
+    if (ambient)
+    {
+      applyAmbient(time + dt);    // Implicit: the new layer's ambient
+      T_end = envTa + delta_T;
+    }
+    if (is_audit)
+      enPrev = theta_buf;
+    (this->*stepFn)(dt);
 
-  double lam1 = lInterp(lLam[wi], theta_buf[i], lAcc);
-  double lam2 = lInterp(lLam[wi + 1], theta_buf[i + 1], lAcc);
-  double lam_ = 0.5 * (lam1 + lam2);
+    time += dt;
+    time_vec.push_back(time);
+    t_ind++;
+    if (events)
+      events->check(time, theta_buf.data(), totalN);
+    if (is_audit)
+    {
+      (this->*auditFn)(dt);
+      if (driftMax > 0.0 && fabs(enDrift) > driftMax)
+        throw err.sendEx("energy balance drift exceeds the limit");
+    }
 
-  return lam_ / crho_;
+    if (progressQ && t_ind % progressEvery == 0)
+      reportProgress(chrono::duration<double>(
+                       chrono::steady_clock::now() - start).count());
+    if (ckptEvery > 0 && t_ind % ckptEvery == 0)
+      saveCheckpoint(ckptPath);
+  }
+  if (progressQ && t_ind % progressEvery != 0)
+    reportProgress(chrono::duration<double>(
+                     chrono::steady_clock::now() - start).count());
+
+  if (!resPath.empty())
+    writeResultsFile(resPath);
+  if (!resBinPath.empty())
+    writeResultsBin(resBinPath);
 }
 
 
-void ImplicitDiffSchemeCyl::calcInnerDF(double dt, size_t wi, size_t i)
+void ImplicitDiffSchemeCyl::reset()
 {
-  double *buf = calcTempCoeffs(wi, i);
-  double a1 = buf[0];
-  double a2 = buf[1];
+  /*
+   * Return to the start state (set by setStartConds, setStartProfile
+   * or loadCheckpoint) for one more solution; the history is cleared.
+   * Without reset() the next solve() continues the current solution.
+   * The events are rearmed.
+  */
 
-  A[i] = a1 * dt * (r[i] + r[i + 1])
-         / (r[i] * (r[i + 1] - r[i]) * (r[i + 1] - r[i - 1]));
-  B[i] = a2 * dt * (r[i] + r[i - 1])
-         / (r[i] * (r[i] - r[i - 1]) * (r[i + 1] - r[i - 1]));
+  if (!is_startConds)
+    throw err.sendEx("start conditions are not initialized");
 
-  a[i] = A[i] / (1.0 + A[i] + B[i] * (1.0 - a[i - 1]));
-  b[i] = theta_buf[i] / A[i] + B[i] / A[i] * a[i - 1] * b[i - 1];
+  time = startTime;
+  setStartTemperature(startTheta);
+  alphaS = 0.0;
+  is_cancel = false;
+  is_cancelled = false;
+  if (events)
+    events->rearm();
 }
 
 
-double* ImplicitDiffSchemeCyl::calcTempCoeffs(size_t wi, size_t i)
+template <class Real>
+void ImplicitDiffSchemeCyl::initScheme(SchemeStore<Real> &s)
 {
-  double *res = new double[2];
-  double theta_p = 0.5 * (theta_buf[i] + theta_buf[i + 1]);
-  double theta_m = 0.5 * (theta_buf[i - 1] + theta_buf[i]);
+  /*
+   * The current state and the walls' data are copied on Real for stepScheme;
+   * with Dual<N> the derivatives are seeded in s (the grid, the tables,
+   * rho, eps, alpha, rOut) before the steps. It's the serial sweep of solve()
+   * with the same policies; the time and the history are the caller's.
+  */
+
+  checkInit();
+  prepareSolve();
+
+  s.theta.assign(theta_buf.begin(), theta_buf.end());
+  s.r.assign(r, r + totalN);
+  s.a.resize(totalN - 1);
+  s.b.resize(totalN - 1);
+  s.A.resize(totalN - 1);
+  s.B.resize(totalN - 1);
+  s.lam.resize(wallsN);
+  s.c.resize(wallsN);
+
+  SchemeVars<Real> &v = s.v;
+  v.lam.resize(wallsN);
+  v.c.resize(wallsN);
+  v.rho.resize(wallsN);
+  for (size_t wi = 0; wi < wallsN; ++wi)
+  {
+    const Wall &w = walls[wi];
+    s.lam[wi].assign(w.lambda, w.lambda + w.dataSize);
+    s.c[wi].assign(w.c, w.c + w.dataSize);
+    v.lam[wi] = s.lam[wi].data();
+    v.c[wi] = s.c[wi].data();
+    v.rho[wi] = w.rho;
+  }
+  v.theta = s.theta.data();
+  v.a = s.a.data();
+  v.b = s.b.data();
+  v.A = s.A.data();
+  v.B = s.B.data();
+  v.r = s.r.data();
+  v.row1 = s.row1;
+  v.row2 = s.row2;
+  v.kh1 = &s.kh1;
+  v.kh2 = &s.kh2;
+  v.alphaS = &s.alphaS;
+  v.eps = walls[wallsN - 1].epsilon;
+  v.alpha1 = bound1.alpha;
+  v.alpha2 = bound2.alpha;
+  v.rOut = walls[wallsN - 1].r2;
+
+  theta_frz.clear();
+  selectStep(v);
+}
 
-  double c = sInterp(l_c[wi], theta_buf[i], lAcc);
-  double rho = walls[wi].rho;
-  double lam1 = sInterp(lLam[wi], theta_p, lAcc);
-  double lam2 = sInterp(lLam[wi], theta_m, lAcc);
 
-  res[0] = lam1 / (c * rho);
-  res[1] = lam2 / (c * rho);
+template <class Real>
+void ImplicitDiffSchemeCyl::stepScheme(double dt, SchemeStore<Real> &s)
+{
+  if (!s.v.stepFn)
+    throw err.sendEx("scheme is not initialized");
+  (this->*s.v.stepFn)(dt, s.v);
+}
 
-  return res;
+
+void ImplicitDiffSchemeCyl::setProgressQueue(SpscQueue<SolveProgress> *q,
+                                             size_t every)
+{
+  if (every == 0)
+    throw err.sendEx("progress must be reported at least every step");
+  progressQ = q;
+  progressEvery = every;
 }
 
 
-void ImplicitDiffSchemeCyl::calcTemperature()
+future<void> ImplicitDiffSchemeCyl::solveAsync(double dt, double delta_T)
 {
-  calcAlphaSum(theta_buf[totalN - 1]);
+  /*
+   * Run solve() on a worker thread.
+   * The solver must not be used until the future is ready;
+   * the exceptions of solve() are rethrown by future::get().
+  */
 
-  double lam = lInterp(lLam[wallsN - 1], theta_buf[totalN - 1], lAcc);
-  double c1 = env.Ta * alphaS * walls[wallsN - 1].step / lam;
-  double c2 = a[totalN - 2] * b[totalN - 2];
-  double c3 = 1.0 - a[totalN - 2];
-  double c4 = alphaS * walls[wallsN - 1].step / lam;
+  is_cancel = false;
+  return async(launch::async, &ImplicitDiffSchemeCyl::solve, this, dt, delta_T);
+}
 
-  size_t i = totalN - 2;
-  theta_buf[totalN - 1] = (c1 + c2) / (c3 + c4);
-  while (i != 0)
-  {
-    theta_buf[i] = a[i] * (b[i] + theta_buf[i + 1]);
-    i--;
-  }
-  theta_buf[0] = a[0] * (b[0] + theta_buf[1]);
 
-  // Writing results
-  Tw_vec.push_back(theta_buf[totalN - 1]);
+void ImplicitDiffSchemeCyl::cancel()
+{
+  // Solution stops after the current step, the results are written
+
+  is_cancel = true;
 }
 
 
-void ImplicitDiffSchemeCyl::calcAlphaSum(double th)
+bool ImplicitDiffSchemeCyl::wasCancelled() const
 {
-  double T = 0.5 * (th + env.Ta);
-  double Gr = g * (th - env.Ta) / T * pow(2.0 * walls[wallsN - 1].r2, 3.0)
-              / pow(sInterp(sEnv_nu, T, sAcc), 2.0);
+  return is_cancelled;
+}
 
-  double  c = 0.0,
-          n = 0.0;
-  double Pr = sInterp(sEnv_Pr, T, sAcc);
 
-  // Heat criterion's coeffs
-  if (Gr * Pr > 5e2 && Gr * Pr < 2e7)
-  {
-    c = 0.54;
-    n = 0.25;
-  }
-  else if (Gr * Pr > 2e7)
+void ImplicitDiffSchemeCyl::showWalls() const
+{
+  if (!walls.empty())
   {
-    c = 0.135;
-    n = 0.333;
+    cout << "Amount of walls: " << wallsN << '\n';
+    for (WallCItr i = walls.begin(); i != walls.end(); ++i)
+      cout << *i;
   }
+}
 
-  // Heat criterion (horizontal cyl)
-  double Nu = c * pow(Gr * Pr, n);
-  double al_c = sInterp(sEnv_lam, T, sAcc) * Nu / (2.0 * walls[wallsN - 1].r2);
-  double q_r = C * walls[wallsN - 1].epsilon
-               * (pow(th / 100.0, 4.0) - pow(env.Ta / 100.0, 4.0));
-  double al_r = q_r / (th - env.Ta);
 
-  alphaS = al_c + al_r;
+void ImplicitDiffSchemeCyl::showEnvironment() const
+{
+  if (is_env)
+    cout << *env << '\n';
 }
 
 
-void ImplicitDiffSchemeCyl::writeResultsFile(const std::string &path)
+const vector<double>& ImplicitDiffSchemeCyl::getTime() const
 {
-  fstream f(path.c_str(), ios_base::out);
-  if (!f.is_open())
-    throw err.sendEx("resulting file is not opened");
-  if (Tw_vec.size() != time_vec.size())
-    throw err.sendEx("size of temperature != size of time");
+  return time_vec;
+}
+
+
+const vector<double>& ImplicitDiffSchemeCyl::getTw() const
+{
+  return Tw_vec;
+}
+
+
+const vector<double>& ImplicitDiffSchemeCyl::getField() const
+{
+  // Temperature field of the current layer, K
+  return theta_buf;
+}
+
+
+vector<double> ImplicitDiffSchemeCyl::getGrid() const
+{
+  // Common coordinates of the nodes, m
+  return calcGridCoords();
+}
+
+
+double ImplicitDiffSchemeCyl::getEnergyStored() const
+{
+  // Change of the stored heat since the start state, J/m
+  return enStored;
+}
+
+
+double ImplicitDiffSchemeCyl::getEnergyLost() const
+{
+  // Heat lost through the bounds since the start state, J/m
+  return enLost;
+}
+
+
+double ImplicitDiffSchemeCyl::getEnergyDrift() const
+{
+  return enDrift;
+}
+
+
+// *** PRIVATE ***
+void ImplicitDiffSchemeCyl::setStartTemperature(const vector<double> &th)
+{
+  // Start temperature destribution (the previous one is replaced)
+
+  startTime = time;
+  startTheta = th;
+  theta_buf = th;
+  theta.assign(1, theta_buf);
+  Tw_vec.assign(1, theta_buf[totalN - 1]);
+  time_vec.assign(1, time);
+  t_ind = 0;
+  theta_frz.clear();
+  frzDF.clear();
+  enRef = 0.0;
+  enStored = enLost = enDrift = 0.0;
+
+  size_t k = 0;
+  for (WallItr itr = walls.begin(); itr != walls.end(); ++itr)
+  {
+    if (itr != walls.begin())
+      k--;                                // Joint node is shared
+    for (size_t i = 0; i < itr->N; ++i)
+      itr->T[i] = theta_buf[k++];
+    itr->is_T = true;
+  }
+}
+
+
+vector<double> ImplicitDiffSchemeCyl::calcGridCoords() const
+{
+  vector<double> rc;
+  rc.reserve(totalN);
+  for (size_t i = 0; i < wallsN; ++i)
+    for (size_t j = (i == 0) ? 0 : 1; j < walls[i].N; ++j)
+      rc.push_back(walls[i].r[j]);
+  return rc;
+}
+
+
+void ImplicitDiffSchemeCyl::prepareSolve()
+{
+  // Only the parts with the changed inputs are rebuilt
+
+  if (is_gridChanged)
+  {
+    freeDF();
+    setCommonCoords();
+    giveMemDF();
+    is_gridChanged = false;
+  }
+  if (is_tablesChanged)
+  {
+    freeLInterp();
+    prepareLInterp();
+    is_tablesChanged = false;
+  }
+
+  TridiagType type = lsType;
+  if (type == TRIDIAG_AUTO)
+    type = (totalN < tridiagCrossover()) ? TRIDIAG_THOMAS : TRIDIAG_CR;
+  if (ls && type != lsActive)
+  {
+    delete ls;
+    ls = nullptr;
+  }
+  if (!ls && type != TRIDIAG_THOMAS)
+    ls = TridiagSolver::create(type, totalN);
+  lsActive = type;
+
+  // Threads of the DD step are created once (a thread per wall)
+  ddPool.resize(is_dd ? wallsN : 1);
+
+  prepareVars();
+}
+
+
+void ImplicitDiffSchemeCyl::prepareVars()
+{
+  // The scheme on double works on the solver's own arrays
+
+  dv.theta = theta_buf.data();
+  dv.a = a;
+  dv.b = b;
+  dv.A = A;
+  dv.B = B;
+  dv.r = r;
+  dv.row1 = row1;
+  dv.row2 = row2;
+  dv.kh1 = &kh1;
+  dv.kh2 = &kh2;
+  dv.alphaS = &alphaS;
+  dv.lam.resize(wallsN);
+  dv.c.resize(wallsN);
+  dv.rho.resize(wallsN);
+  for (size_t wi = 0; wi < wallsN; ++wi)
+  {
+    dv.lam[wi] = walls[wi].lambda;
+    dv.c[wi] = walls[wi].c;
+    dv.rho[wi] = walls[wi].rho;
+  }
+  dv.eps = walls[wallsN - 1].epsilon;
+  dv.alpha1 = bound1.alpha;
+  dv.alpha2 = bound2.alpha;
+  dv.rOut = walls[wallsN - 1].r2;
+}
+
+
+void ImplicitDiffSchemeCyl::checkInit() const
+{
+  // Flags checking
+  if (!is_env)
+    throw err.sendEx("environment is not initialized");
+  if (!is_walls)
+    throw err.sendEx("walls are not initialized");
+  if (!is_bound1)
+    throw err.sendEx("first boundary condition is not initialized");
+  if (!is_bound2)
+    throw err.sendEx("second boundary condition is not initialized");
+  if (!is_startConds)
+    throw err.sendEx("start conditions are not initialized");
+
+  if (alphaTab && !ambient && !alphaTab->fits(envTa, 2.0 * walls[wallsN - 1].r2))
+    throw err.sendEx("alpha table is built for another environment or diameter");
+}
+
+
+void ImplicitDiffSchemeCyl::freeDF()
+{
+  delete [] a;
+  delete [] A;
+  delete [] b;
+  delete [] B;
+  delete [] G;
+  delete [] r;
+  a = A = b = B = G = r = nullptr;
+  mixDt = 0.0;
+}
+
+
+void ImplicitDiffSchemeCyl::freeLInterp()
+{
+  for (size_t i = 0; i < lInterpN; ++i)
+  {
+    gsl_spline_free(lLam[i]);
+    gsl_spline_free(l_c[i]);
+    gsl_interp_accel_free(wAcc[i]);
+  }
+  delete [] lLam;
+  delete [] l_c;
+  delete [] wAcc;
+  lLam = l_c = nullptr;
+  wAcc = nullptr;
+  lInterpN = 0;
+}
+
+
+void ImplicitDiffSchemeCyl::setCommonCoords()
+{
+  vector<double> rc = calcGridCoords();
+  r = new double[totalN];
+  for (size_t i = 0; i < totalN; ++i)
+    r[i] = rc[i];
+}
+
+
+void ImplicitDiffSchemeCyl::prepareLInterp()
+{
+  // Function uses linear interpolation for materials
+  // because temperature changes in narrow interval
+
+  lLam = new gsl_spline*[wallsN];
+  l_c = new gsl_spline*[wallsN];
+  wAcc = new gsl_interp_accel*[wallsN];
+  lInterpN = wallsN;
+  for (size_t i = 0; i < wallsN; ++i)
+  {
+    wAcc[i] = gsl_interp_accel_alloc();
+
+    // lambda
+    lLam[i] = gsl_spline_alloc(gsl_interp_linear, walls[i].dataSize);
+    gsl_spline_init(lLam[i],
+                    walls[i].T_table, walls[i].lambda,
+                    walls[i].dataSize);
+    // c
+    l_c[i] = gsl_spline_alloc(gsl_interp_linear, walls[i].dataSize);
+    gsl_spline_init(l_c[i],
+                    walls[i].T_table, walls[i].c,
+                    walls[i].dataSize);
+  }
+}
+
+
+void ImplicitDiffSchemeCyl::giveMemDF()
+{
+  a = new double[totalN - 1];
+  A = new double[totalN - 1];
+  b = new double[totalN - 1];
+  B = new double[totalN - 1];
+  G = new double[totalN - 1];
+}
+
+
+// *** Boundary condition policies ***
+// Each policy gives the bound equation (row) in the form
+// rw[0] * theta[k] + rw[1] * theta[k -+ 1] = rw[2],
+// where k is the bound node and k -+ 1 is its neighbour in the wall;
+// al_set is the set alpha of the bound, k_h is lambda / step of the bound cell.
+
+struct ImplicitDiffSchemeCyl::TempBound         // Type 1
+{
+  template <class Real>
+  static void row(ImplicitDiffSchemeCyl &, SchemeVars<Real> &, const BoundCond &bc,
+                  const Real &, const Real &, const Real &, Real *rw)
+  {
+    tempBoundRow(bc.T_w, rw);
+  }
+};
+
+
+struct ImplicitDiffSchemeCyl::FluxBound         // Type 2
+{
+  template <class Real>
+  static void row(ImplicitDiffSchemeCyl &, SchemeVars<Real> &, const BoundCond &bc,
+                  const Real &, const Real &, const Real &k_h, Real *rw)
+  {
+    fluxBoundRow(k_h, bc.q, rw);
+  }
+};
+
+
+struct ImplicitDiffSchemeCyl::ConvBound         // Type 3
+{
+  template <class Real>
+  static void row(ImplicitDiffSchemeCyl &s, SchemeVars<Real> &v, const BoundCond &bc,
+                  const Real &al_set, const Real &th, const Real &k_h, Real *rw)
+  {
+    // Set alpha is used if it's given, else natural convection + radiation
+    double Ta = s.ambient ? s.envTa : bc.T_amb;
+    if (bc.alpha < EPS)
+    {
+      s.calcAlphaSum(v, th);
+      Ta = s.envTa;
+    }
+    else
+      *v.alphaS = al_set;
+
+    convBoundRow(k_h, *v.alphaS, Ta, rw);
+  }
+};
+
+
+struct ImplicitDiffSchemeCyl::RadBound          // Type 4 (radiation only)
+{
+  template <class Real>
+  static void row(ImplicitDiffSchemeCyl &s, SchemeVars<Real> &v, const BoundCond &bc,
+                  const Real &, const Real &th, const Real &k_h, Real *rw)
+  {
+    *v.alphaS = EnvModel::alphaRad(th, bc.T_amb, v.eps);
+    convBoundRow(k_h, *v.alphaS, bc.T_amb, rw);
+  }
+};
+// *** END OF Boundary condition policies ***
+
+
+// *** Property evaluation policies ***
+struct ImplicitDiffSchemeCyl::SplineProps       // GSL spline of the table
+{
+  static double eval(const gsl_spline *sp, const double*, const double*,
+                     size_t, double T, gsl_interp_accel *acc)
+  {
+    return gsl_spline_eval(sp, T, acc);
+  }
+
+  // The walls' splines are linear: the seeded table itself is looked up
+  template <size_t N>
+  static Dual<N> eval(const gsl_spline*, const double *x, const Dual<N> *y,
+                      size_t n, const Dual<N> &T, gsl_interp_accel *acc)
+  {
+    return tableLookup(x, y, n, T, acc);
+  }
+};
+
+
+struct ImplicitDiffSchemeCyl::TableProps        // Inline linear table lookup
+{
+  template <class Real>
+  static Real eval(const gsl_spline*, const double *x, const Real *y,
+                   size_t n, const Real &T, gsl_interp_accel *acc)
+  {
+    return tableLookup(x, y, n, T, acc);
+  }
+};
+
+
+template <class Props, class Real>
+Real ImplicitDiffSchemeCyl::lamT(const SchemeVars<Real> &v, size_t wi,
+                                 const Real &T, gsl_interp_accel *acc) const
+{
+  const Wall &w = walls[wi];
+  return Props::eval(lLam[wi], w.T_table, v.lam[wi], w.dataSize, T, acc);
+}
+
+
+template <class Props, class Real>
+Real ImplicitDiffSchemeCyl::cT(const SchemeVars<Real> &v, size_t wi,
+                               const Real &T, gsl_interp_accel *acc) const
+{
+  const Wall &w = walls[wi];
+  return Props::eval(l_c[wi], w.T_table, v.c[wi], w.dataSize, T, acc);
+}
+// *** END OF Property evaluation policies ***
+
+
+template <class Real>
+void ImplicitDiffSchemeCyl::selectStep(SchemeVars<Real> &v)
+{
+  /*
+   * Choose the step functions specialized for the bounds and properties,
+   * so the time loop has no branching on them.
+  */
+
+  if (walls[0].r1 < EPS && (bound1.type != 2 || fabs(bound1.q) > EPS))
+    throw err.sendEx("the axis of the cylinder must have q = 0 (type 2)");
+
+  if (propsEval == PROPS_TABLE)
+    selectBound1<TableProps>(v);
+  else
+    selectBound1<SplineProps>(v);
+}
+
+
+template <class Props, class Real>
+void ImplicitDiffSchemeCyl::selectBound1(SchemeVars<Real> &v)
+{
+  switch (bound1.type)
+  {
+  case 1:
+    selectBound2<TempBound, Props>(v);
+    break;
+  case 2:
+    selectBound2<FluxBound, Props>(v);
+    break;
+  case 3:
+    selectBound2<ConvBound, Props>(v);
+    break;
+  default:
+    throw err.sendEx("this condition type is not supported for the first bound");
+  }
+}
+
+
+template <class Bound1, class Props, class Real>
+void ImplicitDiffSchemeCyl::selectBound2(SchemeVars<Real> &v)
+{
+  switch (bound2.type)
+  {
+  case 1:
+    setStepFuncs<Bound1, TempBound, Props>(v);
+    break;
+  case 2:
+    setStepFuncs<Bound1, FluxBound, Props>(v);
+    break;
+  case 3:
+    setStepFuncs<Bound1, ConvBound, Props>(v);
+    break;
+  case 4:
+    setStepFuncs<Bound1, RadBound, Props>(v);
+    break;
+  default:
+    throw err.sendEx("this condition type is not supported for the second bound");
+  }
+}
+
+
+template <class Bound1, class Bound2, class Props>
+void ImplicitDiffSchemeCyl::setStepFuncs(SchemeVars<double> &)
+{
+  boundFn = &ImplicitDiffSchemeCyl::calcBoundRows<Bound1, Bound2, Props, double>;
+  auditFn = &ImplicitDiffSchemeCyl::calcAudit<Props>;
+
+  if (precision == PRECISION_MIXED)
+  {
+    if (is_dd || ls || is_frozen)
+      throw err.sendEx("mixed precision is supported by the serial sweep only");
+    stepFn = &ImplicitDiffSchemeCyl::calcStepMixed<Bound1, Bound2, Props>;
+  }
+  else if (is_dd)
+    stepFn = &ImplicitDiffSchemeCyl::calcStepDD<Props>;
+  else if (ls)
+    stepFn = &ImplicitDiffSchemeCyl::calcStepLS<Props>;
+  else
+    stepFn = &ImplicitDiffSchemeCyl::calcStep<Bound1, Bound2, Props>;
+}
+
+
+template <class Bound1, class Bound2, class Props, size_t N>
+void ImplicitDiffSchemeCyl::setStepFuncs(SchemeVars<Dual<N> > &v)
+{
+  // Dual numbers take the serial sweep only
+  v.stepFn = &ImplicitDiffSchemeCyl::calcSchemeStep<Bound1, Bound2, Props, Dual<N> >;
+}
+
+
+template <class Bound1, class Bound2, class Props>
+void ImplicitDiffSchemeCyl::calcStep(double dt)
+{
+  calcSchemeStep<Bound1, Bound2, Props>(dt, dv);
+
+  // Writing results
+  Tw_vec.push_back(theta_buf[totalN - 1]);
+}
+
+
+template <class Bound1, class Bound2, class Props, class Real>
+void ImplicitDiffSchemeCyl::calcSchemeStep(double dt, SchemeVars<Real> &v)
+{
+  calcDF<Bound1, Bound2, Props>(dt, v);
+  calcTemperature(v);
+}
+
+
+template <class Bound1, class Bound2, class Props, class Real>
+void ImplicitDiffSchemeCyl::calcDF(double dt, SchemeVars<Real> &v)
+{
+  if (!checkRefresh(v.theta))
+  {
+    calcRhsDF(v);
+    return;
+  }
+
+  calcAB<Props>(dt, v);
+  calcBoundRows<Bound1, Bound2, Props>(v);
+
+  // Forward sweep: theta[i] = a[i] * theta[i + 1] + b[i]
+  v.a[0] = -v.row1[1] / v.row1[0];
+  v.b[0] = v.row1[2] / v.row1[0];
+  for (size_t i = 1; i < totalN - 1; ++i)
+  {
+    Real den = 1.0 + v.A[i] + v.B[i] * (1.0 - v.a[i - 1]);
+    v.a[i] = v.A[i] / den;
+    v.b[i] = (v.theta[i] + v.B[i] * v.b[i - 1]) / den;
+  }
+}
+
+
+template <class Props, class Real>
+void ImplicitDiffSchemeCyl::calcAB(double dt, SchemeVars<Real> &v)
+{
+  size_t wi = 0;
+  size_t n = walls[wi].N - 1;
+
+  for (size_t i = 1; i < totalN - 1; ++i)
+  {
+    if (i == n && wi != wallsN - 1)           // Joint case condition
+    {
+      n += walls[wi + 1].N - 1;
+      calcJointAB<Props>(dt, v, wi, i);
+      wi++;
+      continue;
+    }
+    calcInnerAB<Props>(dt, v, wi, i, lAcc);
+  }
+}
+
+
+template <class Bound1, class Bound2, class Props, class Real>
+void ImplicitDiffSchemeCyl::calcBoundRows(SchemeVars<Real> &v)
+{
+  size_t n = totalN - 1;
+
+  *v.kh1 = lamT<Props>(v, 0, v.theta[0], lAcc) / (v.r[1] - v.r[0]);
+  Bound1::row(*this, v, bound1, v.alpha1, v.theta[0], *v.kh1, v.row1);
+
+  *v.kh2 = lamT<Props>(v, wallsN - 1, v.theta[n], lAcc) / (v.r[n] - v.r[n - 1]);
+  Bound2::row(*this, v, bound2, v.alpha2, v.theta[n], *v.kh2, v.row2);
+}
+
+
+template <class Real>
+bool ImplicitDiffSchemeCyl::isRefreshNeeded(const Real *th) const
+{
+  if (theta_frz.size() != totalN)
+    return true;
+
+  for (size_t i = 0; i < totalN; ++i)
+    if (fabs(valueOf(th[i]) - theta_frz[i]) > frozenTol)
+      return true;
+  return false;
+}
+
+
+template <class Real>
+bool ImplicitDiffSchemeCyl::checkRefresh(const Real *th)
+{
+  // Should the coefficients be recalculated on this step
+
+  is_refreshed = !is_frozen || isRefreshNeeded(th);
+  if (is_frozen && is_refreshed)
+  {
+    theta_frz.resize(totalN);
+    for (size_t i = 0; i < totalN; ++i)
+      theta_frz[i] = valueOf(th[i]);
+  }
+  return is_refreshed;
+}
+
+
+template <class Real>
+void ImplicitDiffSchemeCyl::calcRhsDF(SchemeVars<Real> &v)
+{
+  // Forward sweep for the right-hand side only (a, A, B, rows are frozen)
+
+  v.b[0] = v.row1[2] / v.row1[0];
+  for (size_t i = 1; i < totalN - 1; ++i)
+    v.b[i] = v.a[i] / v.A[i] * (v.theta[i] + v.B[i] * v.b[i - 1]);
+}
+
+
+template <class Props, class Real>
+void ImplicitDiffSchemeCyl::calcJointAB(double dt, SchemeVars<Real> &v,
+                                        size_t wi, size_t i)
+{
+  Real _a = calcJointTempCoeff<Props>(v, wi, i);
+  radialAB(v.r, i, dt, _a, _a, v.A[i], v.B[i]);
+}
+
+
+template <class Props, class Real>
+Real ImplicitDiffSchemeCyl::calcJointTempCoeff(const SchemeVars<Real> &v,
+                                               size_t wi, size_t i)
+{
+  if (wi == wallsN - 1)
+    throw err.sendEx("the last wall doesn't have outer joint");
+
+  Real c1 = cT<Props>(v, wi, v.theta[i], lAcc);
+  Real c2 = cT<Props>(v, wi + 1, v.theta[i + 1], lAcc);
+
+  // Steps adjoining the joint (the grid may be non-uniform)
+  Real h1 = v.r[i] - v.r[i - 1];
+  Real h2 = v.r[i + 1] - v.r[i];
+
+  Real lam1 = lamT<Props>(v, wi, v.theta[i], lAcc);
+  Real lam2 = lamT<Props>(v, wi + 1, v.theta[i + 1], lAcc);
+
+  return jointDiffusivity(h1, h2, c1 * v.rho[wi], c2 * v.rho[wi + 1],
+                          lam1, lam2);
+}
+
+
+template <class Props, class Real>
+void ImplicitDiffSchemeCyl::calcInnerAB(double dt, SchemeVars<Real> &v,
+                                        size_t wi, size_t i, gsl_interp_accel *acc)
+{
+  Real buf[2];
+  calcTempCoeffs<Props>(v, wi, i, buf, acc);
+  radialAB(v.r, i, dt, buf[0], buf[1], v.A[i], v.B[i]);
+}
+
+
+template <class Props, class Real>
+void ImplicitDiffSchemeCyl::calcTempCoeffs(const SchemeVars<Real> &v, size_t wi,
+                                           size_t i, Real *res,
+                                           gsl_interp_accel *acc)
+{
+  Real theta_p = 0.5 * (v.theta[i] + v.theta[i + 1]);
+  Real theta_m = 0.5 * (v.theta[i - 1] + v.theta[i]);
+
+  Real c = cT<Props>(v, wi, v.theta[i], acc);
+  Real rho = v.rho[wi];
+  Real lam1 = lamT<Props>(v, wi, theta_p, acc);
+  Real lam2 = lamT<Props>(v, wi, theta_m, acc);
+
+  res[0] = lam1 / (c * rho);
+  res[1] = lam2 / (c * rho);
+}
+
+
+template <class Real>
+void ImplicitDiffSchemeCyl::calcTemperature(SchemeVars<Real> &v)
+{
+  // Outer bound row with theta[n - 1] = a[n - 1] * theta[n] + b[n - 1]
+  size_t i = totalN - 1;
+  v.theta[i] = (v.row2[2] - v.row2[1] * v.b[i - 1])
+               / (v.row2[0] + v.row2[1] * v.a[i - 1]);
+  while (i != 0)
+  {
+    i--;
+    v.theta[i] = v.a[i] * v.theta[i + 1] + v.b[i];
+  }
+}
+
+
+// *** Mixed precision ***
+template <class Bound1, class Bound2, class Props>
+void ImplicitDiffSchemeCyl::calcStepMixed(double dt)
+{
+  /*
+   * The increment d = theta_new - theta of M * theta_new = theta
+   * is solved from M * d = theta - M * theta: the residual is double,
+   * so the float rounding only spoils the small increment.
+  */
+
+  calcABMixed<Props>(dt);
+  calcBoundRows<Bound1, Bound2, Props>(dv);
+
+  thPrev = theta_buf;
+  calcResidualMixed();
+  solveIncMixed(true);
+  for (size_t k = 0; k < refineN; ++k)
+  {
+    calcResidualMixed();
+    solveIncMixed(false);
+  }
+
+  Tw_vec.push_back(theta_buf[totalN - 1]);
+}
+
+
+void ImplicitDiffSchemeCyl::calcGeomFactors(double dt)
+{
+  // Factors of A and B depending on the grid and dt only
+
+  gA.assign(totalN, 0.0f);
+  gB.assign(totalN, 0.0f);
+  for (size_t i = 1; i < totalN - 1; ++i)
+  {
+    gA[i] = float(dt * (r[i] + r[i + 1])
+                  / (r[i] * (r[i + 1] - r[i]) * (r[i + 1] - r[i - 1])));
+    gB[i] = float(dt * (r[i] + r[i - 1])
+                  / (r[i] * (r[i] - r[i - 1]) * (r[i + 1] - r[i - 1])));
+  }
+  fA.resize(totalN);
+  fB.resize(totalN);
+  fa.resize(totalN);
+  fb.resize(totalN);
+  res.resize(totalN);
+  mixDt = dt;
+}
+
+
+template <class Props>
+void ImplicitDiffSchemeCyl::calcABMixed(double dt)
+{
+  // lambda of the face i - 1/2 is taken from the node i - 1 inside a wall
+
+  if (dt != mixDt || gA.size() != totalN)
+    calcGeomFactors(dt);
+
+  size_t wi = 0;
+  size_t n = walls[wi].N - 1;
+  double lam_m = 0.0;
+  bool is_face = false;
+
+  for (size_t i = 1; i < totalN - 1; ++i)
+  {
+    if (i == n && wi != wallsN - 1)           // Joint case condition
+    {
+      n += walls[wi + 1].N - 1;
+      float a_ = float(calcJointTempCoeff<Props>(dv, wi, i));
+      fA[i] = a_ * gA[i];
+      fB[i] = a_ * gB[i];
+      wi++;
+      is_face = false;
+      continue;
+    }
+
+    if (!is_face)
+      lam_m = lamT<Props>(dv, wi, 0.5 * (theta_buf[i - 1] + theta_buf[i]), lAcc);
+    double lam_p = lamT<Props>(dv, wi, 0.5 * (theta_buf[i] + theta_buf[i + 1]), lAcc);
+    double crho = cT<Props>(dv, wi, theta_buf[i], lAcc) * walls[wi].rho;
+
+    fA[i] = float(lam_p / crho) * gA[i];
+    fB[i] = float(lam_m / crho) * gB[i];
+    lam_m = lam_p;
+    is_face = true;
+  }
+}
+
+
+void ImplicitDiffSchemeCyl::calcResidualMixed()
+{
+  // res = thPrev - M * theta_buf
+
+  size_t n = totalN - 1;
+  res[0] = row1[2] - row1[0] * theta_buf[0] - row1[1] * theta_buf[1];
+  for (size_t i = 1; i < n; ++i)
+    res[i] = thPrev[i] - theta_buf[i]
+             + double(fB[i]) * (theta_buf[i - 1] - theta_buf[i])
+             + double(fA[i]) * (theta_buf[i + 1] - theta_buf[i]);
+  res[n] = row2[2] - row2[0] * theta_buf[n] - row2[1] * theta_buf[n - 1];
+}
+
+
+void ImplicitDiffSchemeCyl::solveIncMixed(bool factorize)
+{
+  /*
+   * Float sweep d[i] = fa[i] * d[i + 1] + fb[i], fa is kept for the refinement.
+   * 1 - fa[i] is carried as e (fa -> 1 for the large A), so the float
+   * denominator doesn't lose its 1.
+  */
+
+  size_t n = totalN - 1;
+  float r0 = float(row1[0]);
+  if (factorize)
+  {
+    fa[0] = -float(row1[1]) / r0;
+    float e = float((row1[0] + row1[1]) / row1[0]);
+    for (size_t i = 1; i < n; ++i)
+    {
+      float den = 1.0f + fA[i] + fB[i] * e;
+      fa[i] = fA[i] / den;
+      e = (1.0f + fB[i] * e) / den;
+    }
+  }
+  fb[0] = float(res[0]) / r0;
+  for (size_t i = 1; i < n; ++i)
+    fb[i] = (float(res[i]) + fB[i] * fb[i - 1]) * fa[i] / fA[i];
+
+  float d = (float(res[n]) - float(row2[1]) * fb[n - 1])
+            / (float(row2[0]) + float(row2[1]) * fa[n - 1]);
+  theta_buf[n] += d;
+  for (size_t i = n; i != 0; )
+  {
+    i--;
+    d = fa[i] * d + fb[i];
+    theta_buf[i] += d;
+  }
+}
+// *** END OF Mixed precision ***
+
+
+template <class Props>
+void ImplicitDiffSchemeCyl::calcStepLS(double dt)
+{
+  // One time step with the external linear solver
+
+  if (checkRefresh(theta_buf.data()))
+  {
+    calcAB<Props>(dt, dv);
+    (this->*boundFn)(dv);
+  }
+
+  ls_lo.resize(totalN);
+  ls_di.resize(totalN);
+  ls_up.resize(totalN);
+  ls_f.resize(totalN);
+
+  // Inner bound
+  ls_lo[0] = 0.0;
+  ls_di[0] = row1[0];
+  ls_up[0] = row1[1];
+  ls_f[0] = row1[2];
+
+  for (size_t i = 1; i < totalN - 1; ++i)
+  {
+    ls_lo[i] = -B[i];
+    ls_di[i] = 1.0 + A[i] + B[i];
+    ls_up[i] = -A[i];
+    ls_f[i] = theta_buf[i];
+  }
+
+  // Outer bound
+  ls_lo[totalN - 1] = row2[1];
+  ls_di[totalN - 1] = row2[0];
+  ls_up[totalN - 1] = 0.0;
+  ls_f[totalN - 1] = row2[2];
+
+  ls->solve(ls_lo.data(), ls_di.data(), ls_up.data(), ls_f.data(),
+            theta_buf.data(), totalN);
+
+  // Writing results
+  Tw_vec.push_back(theta_buf[totalN - 1]);
+}
+
+
+template <class Props>
+void ImplicitDiffSchemeCyl::calcStepDD(double dt)
+{
+  /*
+   * One time step of the domain-decomposed solution.
+   * Interface nodes I[k] are the inner bound, the joints and the outer bound;
+   * the wall wi owns the inner nodes between I[wi] and I[wi + 1].
+  */
+
+  bool assemble = checkRefresh(theta_buf.data());
+
+  std::vector<size_t> I(wallsN + 1);
+  I[0] = 0;
+  for (size_t wi = 0; wi < wallsN; ++wi)
+    I[wi + 1] = I[wi] + walls[wi].N - 1;
+
+  // Task wallsN: joints and bounds use the common accelerators
+  ddPool.run(wallsN + 1, [&](size_t k)
+  {
+    if (k < wallsN)
+      calcBlockDD<Props>(dt, k, I[k], I[k + 1], assemble);
+    else if (assemble)
+    {
+      for (size_t wi = 0; wi < wallsN - 1; ++wi)
+        calcJointAB<Props>(dt, dv, wi, I[wi + 1]);
+      (this->*boundFn)(dv);
+    }
+  });
+
+  calcInterfaceDD(I);
+
+  ddPool.run(wallsN, [&](size_t wi) { calcBlockTempDD(I[wi], I[wi + 1]); });
+
+  // Writing results
+  Tw_vec.push_back(theta_buf[totalN - 1]);
+}
+
+
+template <class Props>
+void ImplicitDiffSchemeCyl::calcBlockDD(double dt, size_t wi,
+                                        size_t iL, size_t iR, bool assemble)
+{
+  /*
+   * Eliminate the wall's block so that every inner node is expressed as
+   * theta[i] = a[i] * theta[iR] + b[i] + G[i] * theta[iL].
+  */
+
+  for (size_t i = iL + 1; i < iR; ++i)
+  {
+    if (assemble)
+      calcInnerAB<Props>(dt, dv, wi, i, wAcc[wi]);
+
+    double d = 1.0 + A[i] + B[i];
+    if (i == iL + 1)
+    {
+      a[i] = A[i] / d;
+      b[i] = theta_buf[i] / d;
+      G[i] = B[i] / d;
+      continue;
+    }
+    double den = d - B[i] * a[i - 1];
+    a[i] = A[i] / den;
+    b[i] = (theta_buf[i] + B[i] * b[i - 1]) / den;
+    G[i] = B[i] * G[i - 1] / den;
+  }
+
+  // Back sweep: remove the dependence on the right neighbours
+  for (size_t i = iR - 2; i > iL; --i)
+  {
+    b[i] += a[i] * b[i + 1];
+    G[i] += a[i] * G[i + 1];
+    a[i] *= a[i + 1];
+  }
+}
+
+
+void ImplicitDiffSchemeCyl::calcBlockTempDD(size_t iL, size_t iR)
+{
+  for (size_t i = iL + 1; i < iR; ++i)
+    theta_buf[i] = a[i] * theta_buf[iR] + b[i] + G[i] * theta_buf[iL];
+}
+
+
+void ImplicitDiffSchemeCyl::calcInterfaceDD(const std::vector<size_t> &I)
+{
+  /*
+   * Tridiagonal system for the interface temperatures u[k] = theta[I[k]]:
+   * lo[k] * u[k - 1] + di[k] * u[k] + up[k] * u[k + 1] = f[k].
+  */
+
+  size_t m = I.size();
+  std::vector<double> lo(m, 0.0), di(m, 0.0), up(m, 0.0), f(m, 0.0);
+
+  // Inner bound
+  size_t j = I[0] + 1;
+  di[0] = row1[0] + row1[1] * G[j];
+  up[0] = row1[1] * a[j];
+  f[0] = row1[2] - row1[1] * b[j];
+
+  // Joints
+  for (size_t k = 1; k < m - 1; ++k)
+  {
+    size_t i = I[k];
+    size_t jl = i - 1;    // Last inner node of the left block
+    size_t jr = i + 1;    // First inner node of the right block
+    lo[k] = -B[i] * G[jl];
+    di[k] = 1.0 + A[i] + B[i] - B[i] * a[jl] - A[i] * G[jr];
+    up[k] = -A[i] * a[jr];
+    f[k] = theta_buf[i] + B[i] * b[jl] + A[i] * b[jr];
+  }
+
+  // Outer bound
+  j = I[m - 1] - 1;
+  lo[m - 1] = row2[1] * G[j];
+  di[m - 1] = row2[0] + row2[1] * a[j];
+  f[m - 1] = row2[2] - row2[1] * b[j];
+
+  // Thomas algorithm
+  for (size_t k = 1; k < m; ++k)
+  {
+    double w = lo[k] / di[k - 1];
+    di[k] -= w * up[k - 1];
+    f[k] -= w * f[k - 1];
+  }
+  theta_buf[I[m - 1]] = f[m - 1] / di[m - 1];
+  for (size_t k = m - 1; k > 0; --k)
+    theta_buf[I[k - 1]] = (f[k - 1] - up[k - 1] * theta_buf[I[k]]) / di[k - 1];
+}
+
+
+// *** Energy audit ***
+void ImplicitDiffSchemeCyl::prepareAudit()
+{
+  // Control volumes (per 1 m) of the nodes; a joint node is split by the walls
+
+  enWall.resize(totalN);
+  enRhoV.assign(totalN, 0.0);
+  enRhoV2.assign(totalN, 0.0);
+
+  size_t wi = 0;
+  size_t n = walls[wi].N - 1;
+  for (size_t i = 0; i < totalN; ++i)
+  {
+    double rm = (i == 0) ? r[i] : 0.5 * (r[i - 1] + r[i]);
+    double rp = (i == totalN - 1) ? r[i] : 0.5 * (r[i] + r[i + 1]);
+    double vm = M_PI * (r[i] * r[i] - rm * rm);
+    double vp = M_PI * (rp * rp - r[i] * r[i]);
+
+    enWall[i] = wi;
+    if (i == n && wi != wallsN - 1)           // Joint
+    {
+      enRhoV[i] = walls[wi].rho * vm;
+      enRhoV2[i] = walls[wi + 1].rho * vp;
+      wi++;
+      n += walls[wi].N - 1;
+    }
+    else
+      enRhoV[i] = walls[wi].rho * (vm + vp);
+  }
+
+}
+
+
+template <class Props>
+void ImplicitDiffSchemeCyl::calcAudit(double dt)
+{
+  /*
+   * Increment of the stored heat uses c at the mean temperature
+   * of the step; the bound heat uses the rows of the step
+   * (kh2 * (theta[n - 1] - theta[n]) = alphaS * (Tw - Ta) for type 3).
+  */
+
+  size_t n = totalN - 1;
+  double dE = 0.0;
+  double ref = 0.0;
+  for (size_t i = 0; i < totalN; ++i)
+  {
+    double th = 0.5 * (enPrev[i] + theta_buf[i]);
+    double crv = enRhoV[i] * cT<Props>(dv, enWall[i], th, lAcc);
+    if (enRhoV2[i] > 0.0)
+      crv += enRhoV2[i] * cT<Props>(dv, enWall[i] + 1, th, lAcc);
+    dE += crv * (theta_buf[i] - enPrev[i]);
+    ref += crv * fabs(enPrev[i] - envTa);
+  }
+
+  double q_in = 2.0 * M_PI * r[0] * kh1 * (theta_buf[0] - theta_buf[1]);
+  double q_out = 2.0 * M_PI * r[n] * kh2 * (theta_buf[n - 1] - theta_buf[n]);
+
+  if (enRef < EPS)
+    enRef = ref;
+  enStored += dE;
+  enLost += (q_out - q_in) * dt;
+  enDrift = (enRef < EPS) ? 0.0 : (enStored + enLost) / enRef;
+}
+// *** END OF Energy audit ***
+
+
+void ImplicitDiffSchemeCyl::applyAmbient(double t)
+{
+  // Frozen rows hold alphaS * Ta: a new Ta or velocity forces the refresh
+
+  double Ta = ambient->getTa(t);
+  double v = ambient->getVelocity(t);
+  if (Ta != envTa || v != airVel)
+    theta_frz.clear();
+  envTa = Ta;
+  airVel = v;
+}
+
+
+template <class Real>
+void ImplicitDiffSchemeCyl::calcAlphaSum(SchemeVars<Real> &v, const Real &th)
+{
+  Real al_c;
+  if (!tableAlpha(th, al_c))
+    al_c = env->alphaConv(th, envTa, Real(2.0 * v.rOut), airVel, sAcc);
+
+  *v.alphaS = al_c + EnvModel::alphaRad(th, envTa, v.eps);
+}
+
+
+bool ImplicitDiffSchemeCyl::tableAlpha(double th, double &al_c)
+{
+  // Convection alpha of the precomputed table if it covers th
+
+  if (!alphaTab || ambient || !alphaTab->covers(th))
+    return false;
+  al_c = alphaTab->conv(th, tAcc);
+  return true;
+}
+
+
+template <size_t N>
+bool ImplicitDiffSchemeCyl::tableAlpha(const Dual<N>&, Dual<N>&)
+{
+  // The table has no derivatives: the correlation is differentiated
+  return false;
+}
+
+
+void ImplicitDiffSchemeCyl::reportProgress(double elapsed)
+{
+  SolveProgress p;
+  p.step = t_ind;
+  p.time = time;
+  p.Tw = theta_buf[totalN - 1];
+  p.stepsPerSec = (elapsed > 0.0) ? t_ind / elapsed : 0.0;
+  p.drift = is_audit ? enDrift : 0.0;
+  progressQ->push(p);   // Report is dropped if the consumer is late
+}
+
+
+void ImplicitDiffSchemeCyl::writeResultsFile(const std::string &path)
+{
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("resulting file is not opened");
+  if (Tw_vec.size() != time_vec.size())
+    throw err.sendEx("size of temperature != size of time");
 
   f << "t, sec\tT, C\n";
   for (size_t i = 0; i < Tw_vec.size(); ++i)
@@ -484,3 +1866,19 @@ void ImplicitDiffSchemeCyl::writeResultsFile(const std::string &path)
 
   f.close();
 }
+
+
+void ImplicitDiffSchemeCyl::writeResultsBin(const std::string &path)
+{
+  // Binary copy of the results for the memory-mapped comparison view
+
+  vector<double> Tw_C(Tw_vec.size());
+  for (size_t i = 0; i < Tw_vec.size(); ++i)
+    Tw_C[i] = Tw_vec[i] - T_ABS;
+  MappedSeries::write(path, time_vec, Tw_C);
+}
+
+
+// Scheme on the dual numbers of the sensitivities
+template void ImplicitDiffSchemeCyl::initScheme(SchemeStore<SensReal>&);
+template void ImplicitDiffSchemeCyl::stepScheme(double, SchemeStore<SensReal>&);
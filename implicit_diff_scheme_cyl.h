@@ -4,21 +4,104 @@
 #include <gsl/gsl_interp.h>
 #include <gsl/gsl_spline.h>
 
+#include <atomic>
+#include <future>
+#include <memory>
+
 #include "types.h"
+#include "dual.h"
+#include "env_model.h"
+#include "alpha_table.h"
+#include "ambient_stream.h"
+#include "events.h"
+#include "tridiag_solver.h"
+#include "worker_pool.h"
+#include "spsc_queue.h"
 
 #define RES_PATH "../NumSolHeatHomework/results.txt"
+#define RES_BIN_PATH "../NumSolHeatHomework/results.bin"
+
+
+// Progress of the running solution
+struct SolveProgress
+{
+  size_t step;          // Time layer index
+  double time;          // Current time, s
+  double Tw;            // Wall outer temperature, K
+  double stepsPerSec;   // Mean speed of the solution
+  double drift;         // Energy balance drift (0 - audit is off)
+};
+
+
+class ImplicitDiffSchemeCyl;
+
+
+/*
+ * Variables of the implicit scheme on the scalar Real (double or Dual<N>).
+ * The solver's own step runs on SchemeVars<double> over its arrays;
+ * on Dual the derivatives with respect to the seeded entries
+ * (the grid, the tables, rho, ...) are carried through the same code.
+*/
+template <class Real>
+struct SchemeVars
+{
+  Real *theta;                        // Temperature field
+  Real *a, *b, *A, *B;                // Driving factors
+  const Real *r;                      // Common coordinates
+  Real *row1, *row2;                  // Bound equations
+  Real *kh1, *kh2;                    // Conductances lambda / h of the bound rows
+  Real *alphaS;                       // Summary heat emission coeff
+  std::vector<const Real*> lam, c;    // Walls' tables
+  std::vector<Real> rho;              // Walls' densities
+  Real eps;                           // Blackness of the outer wall
+  Real alpha1, alpha2;                // Set heat emission coeffs of the bounds
+  Real rOut;                          // Outer radius
+  void (ImplicitDiffSchemeCyl::*stepFn)(double, SchemeVars&);
+
+  SchemeVars() :
+    theta(nullptr), a(nullptr), b(nullptr), A(nullptr), B(nullptr),
+    r(nullptr), row1(nullptr), row2(nullptr), kh1(nullptr), kh2(nullptr),
+    alphaS(nullptr), stepFn(nullptr)
+  {}
+};
+
+
+// Storage of the scheme's variables on Real (see initScheme), not copyable
+template <class Real>
+struct SchemeStore
+{
+  std::vector<Real> theta, a, b, A, B, r;
+  std::vector<std::vector<Real> > lam, c;
+  Real row1[3], row2[3];
+  Real kh1, kh2, alphaS;
+  SchemeVars<Real> v;
+
+  SchemeStore() {}
+  SchemeStore(const SchemeStore&) = delete;
+  SchemeStore& operator=(const SchemeStore&) = delete;
+};
 
 
 class ImplicitDiffSchemeCyl
 {
 private:
-  Error err;
+  mutable Error err;
 
   // Flags that solver is ready to solve
   bool  is_walls,
         is_startConds,
         is_bound1, is_bound2,
-        is_env;
+        is_env,
+        is_frozen,
+        is_dd;
+
+  // Frozen coefficients mode
+  double frozenTol;                 // Max change of T since the last refresh
+  bool is_refreshed;                // Were the coefficients refreshed on this step
+  std::vector<double> theta_frz;    // Temperature field of the last refresh
+  std::vector<double> frzDF;        // a, A, B of the loaded checkpoint
+  double row1[3], row2[3];          // Bound equations (see bound policies)
+  double kh1, kh2;                  // Conductances lambda / h of the bound rows
 
   size_t totalN;
 
@@ -26,7 +109,8 @@ private:
   Walls walls;                // Vector of walls
   size_t wallsN;              // Amount of walls
   BoundCond bound1, bound2;   // Left & right boundary conditions
-  Environment env;            // Environment data
+  EnvModel *env;              // Environment (owned, may be null)
+  double envTa;               // Ambient temperature (follows the stream)
   double H, D;                // Outer geometry
   double T0;                  // Start temperature
   double time;                // Current time
@@ -34,28 +118,82 @@ private:
   // Driving factors (DF)
   double *a, *A;
   double *b, *B;
+  double *G;                  // Domain decomposition: left interface term
+  WorkerPool ddPool;          // Domain decomposition: threads of the walls
+
+  // Pluggable linear solver (the built-in sweep is used for Thomas)
+  TridiagType lsType;
+  TridiagSolver *ls;
+  std::vector<double> ls_lo, ls_di, ls_up, ls_f;
 
   // For interpolation
   gsl_interp_accel *lAcc;
   gsl_spline **lLam;          // 'l*' means 'linear'
   gsl_spline **l_c;
 
-  double (*lInterp)(const gsl_spline*, double, gsl_interp_accel*);
   // **-pointers are used for each wall
+  gsl_interp_accel **wAcc;    // Accelerators of each wall (for the threads)
 
-  gsl_interp_accel *sAcc;
-  gsl_spline *sEnv_lam;       // 's*' means 'spline'
-  gsl_spline *sEnv_rho;
-  gsl_spline *sEnv_c;
-  gsl_spline *sEnv_a;
-  gsl_spline *sEnv_nu;
-  gsl_spline *sEnv_mu;
-  gsl_spline *sEnv_Pr;
-
-  // Pointer to spline interpolation function
-  double (*sInterp)(const gsl_spline*, double, gsl_interp_accel*);
+  gsl_interp_accel *sAcc;     // Accelerator of the environment's splines
   // .............................................................
 
+  // Step functions specialized for the bounds and properties
+  void (ImplicitDiffSchemeCyl::*stepFn)(double);
+  void (ImplicitDiffSchemeCyl::*boundFn)(SchemeVars<double>&);
+  SchemeVars<double> dv;                  // The scheme on the own arrays
+
+  // Bound and property policies
+  struct TempBound;
+  struct FluxBound;
+  struct ConvBound;
+  struct RadBound;
+  struct SplineProps;
+  struct TableProps;
+
+  // Asynchronous solution
+  std::atomic<bool> is_cancel;            // Cooperative cancellation request
+  bool is_cancelled;                      // Was the last solution cancelled
+  SpscQueue<SolveProgress> *progressQ;    // Progress reports (may be null)
+  size_t progressEvery;                   // Report every n-th step
+
+  // Results output
+  std::string resPath, resBinPath;        // Empty path - file isn't written
+  double timeMax;                         // Time limit of the solution
+  EventEngine *events;                    // Stop conditions (may be null)
+
+  // Checkpoints
+  std::string ckptPath;
+  size_t ckptEvery;                       // Save every n-th step (0 - off)
+
+  // Reuse: what is to be rebuilt by the next solve()
+  bool is_gridChanged;                    // Coordinates and driving factors
+  bool is_tablesChanged;                  // Walls' splines
+  size_t lInterpN;                        // Number of the walls' splines
+  std::string envPath;                    // Source of the environment table
+  TridiagType lsActive;                   // Type of the created linear solver
+  double startTime;                       // Start state for reset()
+  std::vector<double> startTheta;
+
+  // Precomputed natural convection (may be null, not owned unless shared)
+  const AlphaTable *alphaTab;
+  std::shared_ptr<const AlphaTable> alphaKeep;
+  gsl_interp_accel *tAcc;
+
+  // Measured ambient history of the type 3 bound (may be null, not owned)
+  AmbientStream *ambient;
+  double airVel;                          // Forced convection velocity
+
+  // Energy audit: stored heat vs the heat crossed the bounds (per 1 m)
+  bool is_audit;
+  double driftMax;                        // Abort limit of the drift (0 - off)
+  std::vector<size_t> enWall;             // Wall of the node (left part at joints)
+  std::vector<double> enRhoV;             // rho * V of the node in the wall
+  std::vector<double> enRhoV2;            // rho * V in the next wall (joints)
+  std::vector<double> enPrev;             // Field of the previous layer
+  double enRef;                           // Start heat relative to Ta
+  double enStored, enLost, enDrift;
+  void (ImplicitDiffSchemeCyl::*auditFn)(double);
+
   // Others
   size_t t_ind;   // Current time layer index
   double alphaS;  // Summary heat emission coeff
@@ -67,39 +205,147 @@ private:
   std::vector<double> theta_buf;            // 1D vector for the adding to 2D theta vector
   std::vector<double> Tw_vec;               // Wall outer temperature vector
 
+public:
+  enum PropsEval { PROPS_SPLINE, PROPS_TABLE };
+  enum Precision { PRECISION_DOUBLE, PRECISION_MIXED };
+
+private:
+  PropsEval propsEval;
+
+  // Mixed precision: float coefficients and sweep, double field
+  Precision precision;
+  size_t refineN;                   // Refinement solves per step
+  double mixDt;                     // Time step of the geometric factors
+  std::vector<float> gA, gB;        // dt * geometric factors of A and B
+  std::vector<float> fA, fB;        // Coefficients
+  std::vector<float> fa, fb;        // Sweep factors
+  std::vector<double> res;          // Residual of the increment's system
+  std::vector<double> thPrev;       // Field of the previous layer
+
 public:
   ImplicitDiffSchemeCyl();
   ~ImplicitDiffSchemeCyl();
 
+  ImplicitDiffSchemeCyl(const ImplicitDiffSchemeCyl&) = delete;
+  ImplicitDiffSchemeCyl& operator=(const ImplicitDiffSchemeCyl&) = delete;
+
   void setWalls(const Walls &ws);
   void setStartConds(const StartConds &sc);
+  void setStartProfile(const std::vector<double> &r_prof,
+                       const std::vector<double> &T_C);
   void setFirstBound(const BoundCond &bc);
   void setSecondBound(const BoundCond &bc);
   void setEnvironment(double t_amb_C, const std::string &src_path);
+  void setFrozenCoeffs(double delta_T);
+  void setDomainDecomp(bool on);
+  void setLinearSolver(TridiagType type);
+  void setPropsEval(PropsEval pe);
+  void setPrecision(Precision p, size_t refine = 0);
+  void setResultsPath(const std::string &path, const std::string &bin_path);
+  void setMaxTime(double t_max);
+  void setEvents(EventEngine *e);
+  void setAlphaTable(const AlphaTable *table);
+  void setAlphaTable(std::shared_ptr<const AlphaTable> table);
+  void setAmbientStream(AmbientStream *s);
+  void setEnergyAudit(bool on, double max_drift = 0.0);
+  void setCheckpoint(const std::string &path, size_t every);
+
+  // Checkpoint/restart
+  void saveCheckpoint(const std::string &path) const;
+  void loadCheckpoint(const std::string &path);
 
   void solve(double dt, double t_end_C);
+  void reset();
+
+  // Scheme on Real (e.g. Dual<N> for the sensitivities)
+  template <class Real> void initScheme(SchemeStore<Real> &s);
+  template <class Real> void stepScheme(double dt, SchemeStore<Real> &s);
+
+  // Async solution
+  void setProgressQueue(SpscQueue<SolveProgress> *q, size_t every = 1);
+  std::future<void> solveAsync(double dt, double t_end_C);
+  void cancel();
+  bool wasCancelled() const;
 
   // Out funcs
   void showWalls() const;
+  void showEnvironment() const;
+  const std::vector<double>& getTime() const;
+  const std::vector<double>& getTw() const;
+  const std::vector<double>& getField() const;
+  std::vector<double> getGrid() const;
+  double getEnergyStored() const;
+  double getEnergyLost() const;
+  double getEnergyDrift() const;
 
 private:
-  void setStartTemperature();
+  void setStartTemperature(const std::vector<double> &th);
+  std::vector<double> calcGridCoords() const;
   void setCommonCoords();
-  size_t calcEnvSize(const std::string &path);
-  void readEnvData(const std::string &path);
-  void giveMemEnv();
   void prepareLInterp();
-  void prepareSInterp();
   void giveMemDF();
-  void calcDF(double dt);
-  void calcJointDF(double dt, size_t wi, size_t i);
-  void calcInnerDF(double dt, size_t wi, size_t i);
-  void setStartDF();
-  double* calcTempCoeffs(size_t wi, size_t i);
-  double calcJointTempCoeff(size_t wi, size_t i);
-  void calcTemperature();
-  void calcAlphaSum(double th);
+  void prepareSolve();
+  void prepareVars();
+  void checkInit() const;
+  void freeDF();
+  void freeLInterp();
+  template <class Real> void selectStep(SchemeVars<Real> &v);
+  template <class Props, class Real> void selectBound1(SchemeVars<Real> &v);
+  template <class Bound1, class Props, class Real>
+  void selectBound2(SchemeVars<Real> &v);
+  template <class Bound1, class Bound2, class Props>
+  void setStepFuncs(SchemeVars<double> &v);
+  template <class Bound1, class Bound2, class Props, size_t N>
+  void setStepFuncs(SchemeVars<Dual<N> > &v);
+  template <class Bound1, class Bound2, class Props> void calcStep(double dt);
+  template <class Bound1, class Bound2, class Props, class Real>
+  void calcSchemeStep(double dt, SchemeVars<Real> &v);
+  template <class Bound1, class Bound2, class Props, class Real>
+  void calcDF(double dt, SchemeVars<Real> &v);
+  template <class Bound1, class Bound2, class Props, class Real>
+  void calcBoundRows(SchemeVars<Real> &v);
+  template <class Props, class Real> void calcAB(double dt, SchemeVars<Real> &v);
+  template <class Real> bool isRefreshNeeded(const Real *th) const;
+  template <class Real> bool checkRefresh(const Real *th);
+  template <class Real> void calcRhsDF(SchemeVars<Real> &v);
+  template <class Props, class Real>
+  void calcJointAB(double dt, SchemeVars<Real> &v, size_t wi, size_t i);
+  template <class Props, class Real>
+  Real calcJointTempCoeff(const SchemeVars<Real> &v, size_t wi, size_t i);
+  template <class Props, class Real>
+  void calcInnerAB(double dt, SchemeVars<Real> &v, size_t wi, size_t i,
+                   gsl_interp_accel *acc);
+  template <class Props, class Real>
+  void calcTempCoeffs(const SchemeVars<Real> &v, size_t wi, size_t i,
+                      Real *res, gsl_interp_accel *acc);
+  template <class Props, class Real>
+  Real lamT(const SchemeVars<Real> &v, size_t wi, const Real &T,
+            gsl_interp_accel *acc) const;
+  template <class Props, class Real>
+  Real cT(const SchemeVars<Real> &v, size_t wi, const Real &T,
+          gsl_interp_accel *acc) const;
+  template <class Real> void calcTemperature(SchemeVars<Real> &v);
+  template <class Props> void calcStepLS(double dt);
+  template <class Bound1, class Bound2, class Props>
+  void calcStepMixed(double dt);
+  template <class Props> void calcABMixed(double dt);
+  void calcGeomFactors(double dt);
+  void calcResidualMixed();
+  void solveIncMixed(bool factorize);
+  template <class Props> void calcStepDD(double dt);
+  template <class Props>
+  void calcBlockDD(double dt, size_t wi, size_t iL, size_t iR, bool assemble);
+  void calcBlockTempDD(size_t iL, size_t iR);
+  void calcInterfaceDD(const std::vector<size_t> &I);
+  void applyAmbient(double t);
+  void prepareAudit();
+  template <class Props> void calcAudit(double dt);
+  template <class Real> void calcAlphaSum(SchemeVars<Real> &v, const Real &th);
+  bool tableAlpha(double th, double &al_c);
+  template <size_t N> bool tableAlpha(const Dual<N> &th, Dual<N> &al_c);
+  void reportProgress(double elapsed);
   void writeResultsFile(const std::string &path);
+  void writeResultsBin(const std::string &path);
 };
 
 
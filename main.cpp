@@ -1,10 +1,14 @@
 #include <QApplication>
+#include <QTimer>
 
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <string>
 
 #include "implicit_diff_scheme_cyl.h"
 #include "plotter.h"
+#include "compare_plotter.h"
 #include "mainwindow.h"
 
 
@@ -12,6 +16,44 @@ using namespace std;
 
 int main(int argc, char *argv[])
 {
+  QApplication a(argc, argv);
+
+  // Comparison of the runs (*.bin) and experiments (text with a header):
+  // NumSolHeatHomework --compare <file> [<file> ...]
+  if (argc > 2 && string(argv[1]) == "--compare")
+  {
+    ComparePlotter cmp;
+    try
+    {
+      for (int i = 2; i < argc; ++i)
+      {
+        string path(argv[i]);
+        QString name = QString::fromStdString(path);
+        if (path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0)
+          cmp.addRun(path, name);
+        else
+          cmp.addExperiment(path, true, name);
+      }
+      cmp.setAxis(0, 30000, 20, 100, 7, 9);
+    }
+    catch (const string& ex)
+    {
+      cout << ex;
+    }
+
+    MainWindow w;
+    w.setCentralWidget(cmp.getChartView());
+    w.resize(1200, 800);
+    w.show();
+    return a.exec();
+  }
+
+  // The solution runs on a worker thread, the chart grows live
+  ImplicitDiffSchemeCyl solver;
+  SpscQueue<SolveProgress> progress(4096);
+  future<void> solution;
+  Plotter plot;
+
   try
   {
     const size_t n = 3;
@@ -133,7 +175,6 @@ int main(int argc, char *argv[])
     bc2.setType3(ta);
 
     // Solution
-    ImplicitDiffSchemeCyl solver;
     // ...set walls
     solver.setWalls(walls);
     // ...for init control
@@ -144,11 +185,11 @@ int main(int argc, char *argv[])
     // ...set start conditions and environment
     solver.setStartConds(sc);
     solver.setEnvironment(ta, "../NumSolHeatHomework/env_data.txt");
+    solver.showEnvironment();
 
-    solver.solve(dt, delta_t);
-
-    // ...for init control
-    solver.showWalls();
+    solver.setProgressQueue(&progress);
+    plot.addPoint(sc.time, t0);
+    solution = solver.solveAsync(dt, delta_t);
   }
   catch (const string& ex)
   {
@@ -156,10 +197,8 @@ int main(int argc, char *argv[])
   }
 
   // Graphic part
-  QApplication a(argc, argv);
-
-  Plotter plot;
-  plot.setData("../NumSolHeatHomework/results.txt", true);
+  if (!solution.valid())
+    plot.setData("../NumSolHeatHomework/results.txt", true);
   plot.createChart();
   plot.setAxis(0, 30000, 20, 100, 7, 9);
 //  plot.setAxis();
@@ -167,7 +206,63 @@ int main(int argc, char *argv[])
   MainWindow w;
   w.setCentralWidget(plot.getChartView());
   w.resize(1200, 800);
+  w.setStopHandler([&solver]() { solver.cancel(); });
   w.show();
 
-  return a.exec();
+  // Moving the progress reports to the chart
+  QTimer timer;
+  QObject::connect(&timer, &QTimer::timeout, [&]()
+  {
+    // Readiness is checked first: all the reports of the finished
+    // solution are in the queue then and are drained by this tick
+    bool is_done = solution.valid() &&
+                   solution.wait_for(chrono::seconds(0)) == future_status::ready;
+
+    SolveProgress p;
+    bool is_p = false;
+    while (progress.pop(p))
+    {
+      plot.addPoint(p.time, p.Tw - T_ABS);
+      is_p = true;
+    }
+    plot.refresh();
+    if (is_p)
+      w.showStatus(QString("t = %1 s\tTw = %2 C\t%3 steps/s")
+                   .arg(p.time).arg(p.Tw - T_ABS).arg(p.stepsPerSec, 0, 'f', 0));
+
+    if (is_done)
+    {
+      timer.stop();
+      try
+      {
+        solution.get();
+        w.showStatus(solver.wasCancelled() ? "Stopped" : "Solved");
+        // ...for init control
+        solver.showWalls();
+      }
+      catch (const string& ex)
+      {
+        cout << ex;
+      }
+    }
+  });
+  timer.start(100);
+
+  int res = a.exec();
+
+  // The window is closed before the end of the solution
+  if (solution.valid())
+  {
+    solver.cancel();
+    try
+    {
+      solution.get();
+    }
+    catch (const string& ex)
+    {
+      cout << ex;
+    }
+  }
+
+  return res;
 }
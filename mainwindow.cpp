@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <QAction>
+
 
 MainWindow::MainWindow(QWidget *parent) :
   QMainWindow(parent),
@@ -13,3 +15,16 @@ MainWindow::~MainWindow()
 {
   delete ui;
 }
+
+
+void MainWindow::setStopHandler(const std::function<void()> &handler)
+{
+  QAction *stop = ui->mainToolBar->addAction("Stop");
+  connect(stop, &QAction::triggered, handler);
+}
+
+
+void MainWindow::showStatus(const QString &mess)
+{
+  ui->statusBar->showMessage(mess);
+}
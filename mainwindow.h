@@ -2,6 +2,9 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QString>
+
+#include <functional>
 
 namespace Ui {
 class MainWindow;
@@ -15,6 +18,9 @@ public:
   explicit MainWindow(QWidget *parent = nullptr);
   ~MainWindow();
 
+  void setStopHandler(const std::function<void()> &handler);
+  void showStatus(const QString &mess);
+
 private:
   Ui::MainWindow *ui;
 };
@@ -0,0 +1,117 @@
+#include "mapped_series.h"
+
+#include <fstream>
+#include <string.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+using namespace std;
+
+
+#define SERIES_MAGIC "NSHS"
+#define SERIES_HEAD 16      // Size of the header, bytes
+
+
+MappedSeries::MappedSeries(const string &path) : addr(nullptr), len(0), n(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw err.sendEx("file is not opened");
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < SERIES_HEAD)
+  {
+    close(fd);
+    throw err.sendEx("file is not a series file");
+  }
+  len = size_t(st.st_size);
+
+  addr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    throw err.sendEx("file is not mapped");
+
+  const char *p = static_cast<const char*>(addr);
+  uint64_t size;
+  memcpy(&size, p + 8, sizeof(size));
+  if (memcmp(p, SERIES_MAGIC, 4) != 0
+      || len != SERIES_HEAD + 2 * size * sizeof(double))
+  {
+    munmap(addr, len);
+    throw err.sendEx("file is not a series file");
+  }
+  n = size_t(size);
+
+  // Data are read once from the begin to the end (by the pyramid)
+  madvise(addr, len, MADV_SEQUENTIAL);
+}
+
+
+MappedSeries::~MappedSeries()
+{
+  munmap(addr, len);
+}
+
+
+const double* MappedSeries::x() const
+{
+  return reinterpret_cast<const double*>(static_cast<const char*>(addr)
+                                         + SERIES_HEAD);
+}
+
+
+const double* MappedSeries::y() const
+{
+  return x() + n;
+}
+
+
+void MappedSeries::release(size_t i_end) const
+{
+  /*
+   * Pages of x[0, i_end) and y[0, i_end) are dropped from the memory
+   * (they're read from the file again if accessed), so a long series
+   * read by a moving cursor takes bounded memory.
+  */
+
+  if (i_end > n)
+    i_end = n;
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  const char *base = static_cast<const char*>(addr);
+  size_t offs[2] = { SERIES_HEAD, SERIES_HEAD + n * sizeof(double) };
+  for (int k = 0; k < 2; ++k)
+  {
+    size_t from = (offs[k] + page - 1) / page * page;
+    size_t to = (offs[k] + i_end * sizeof(double)) / page * page;
+    if (to > from)
+      madvise(const_cast<char*>(base) + from, to - from, MADV_DONTNEED);
+  }
+}
+
+
+void MappedSeries::write(const string &path,
+                         const vector<double> &x, const vector<double> &y)
+{
+  Error err;
+  if (x.size() != y.size())
+    throw err.sendEx("size of X != size of Y");
+
+  fstream f(path.c_str(), ios_base::out | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("series file is not opened");
+
+  char head[SERIES_HEAD] = { 0 };
+  uint64_t size = x.size();
+  memcpy(head, SERIES_MAGIC, 4);
+  memcpy(head + 8, &size, sizeof(size));
+  f.write(head, SERIES_HEAD);
+  f.write(reinterpret_cast<const char*>(x.data()), x.size() * sizeof(double));
+  f.write(reinterpret_cast<const char*>(y.data()), y.size() * sizeof(double));
+
+  f.close();
+}
@@ -0,0 +1,43 @@
+#ifndef MAPPED_SERIES_H
+#define MAPPED_SERIES_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "err.h"
+
+
+/*
+ * Binary series file mapped into memory (read only, POSIX mmap).
+ * Format: "NSHS", 4 bytes of padding, uint64 n, n doubles x, n doubles y.
+ * Pages are read by the OS only when they're accessed.
+*/
+class MappedSeries
+{
+private:
+  Error err;
+
+  void *addr;         // Mapped file
+  size_t len;         // Size of the mapping
+  size_t n;           // Number of points
+
+public:
+  explicit MappedSeries(const std::string &path);
+  ~MappedSeries();
+
+  size_t size() const { return n; }
+  const double* x() const;
+  const double* y() const;
+  void release(size_t i_end) const;
+
+  static void write(const std::string &path,
+                    const std::vector<double> &x, const std::vector<double> &y);
+
+private:
+  MappedSeries(const MappedSeries&);
+  MappedSeries& operator=(const MappedSeries&);
+};
+
+
+#endif // MAPPED_SERIES_H
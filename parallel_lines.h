@@ -0,0 +1,38 @@
+#ifndef PARALLEL_LINES_H
+#define PARALLEL_LINES_H
+
+#include <cstddef>
+
+#include "worker_pool.h"
+
+
+/*
+ * Run line(k1, k2, t) over [0; count) split into contiguous chunks,
+ * one chunk per thread of the pool (t - index of the chunk, for the scratch
+ * memory). Small jobs (work = count * cost < min_work) are run on the
+ * caller's thread.
+*/
+template <class Line>
+void runLines(WorkerPool &pool, size_t count, size_t cost, size_t min_work,
+              Line line)
+{
+  size_t tn = pool.size();
+  if (tn > count)
+    tn = count;
+  if (tn < 2 || count * cost < min_work)
+  {
+    line(0, count, 0);
+    return;
+  }
+
+  size_t chunk = (count + tn - 1) / tn;
+  pool.run(tn, [&](size_t t)
+  {
+    size_t k1 = t * chunk;
+    if (k1 < count)
+      line(k1, (k1 + chunk < count) ? k1 + chunk : count, t);
+  });
+}
+
+
+#endif // PARALLEL_LINES_H
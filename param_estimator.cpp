@@ -0,0 +1,253 @@
+#include "param_estimator.h"
+
+#include <fstream>
+#include <future>
+#include <math.h>
+
+
+using namespace std;
+
+
+ParamEstimator::ParamEstimator(const HeatCase &c) :
+  hc(c), lambdaLM(1e-3), rms(0.0) {}
+
+
+void ParamEstimator::addParam(const CaseParam &cp)
+{
+  // The current value of the case is the initial guess
+
+  p.push_back(cp.get(hc));
+  params.push_back(cp);
+}
+
+
+void ParamEstimator::setMeasurements(const vector<double> &t,
+                                     const vector<double> &T_C)
+{
+  if (t.size() != T_C.size())
+    throw err.sendEx("size of time != size of temperature");
+  if (t.empty())
+    throw err.sendEx("measurements are empty");
+  for (size_t i = 1; i < t.size(); ++i)
+    if (t[i] < t[i - 1])
+      throw err.sendEx("measurements' time must be nondecreasing");
+
+  t_meas = t;
+  T_meas = T_C;
+  hc.t_max = t.back();
+  hc.delta_T = 0.0;
+}
+
+
+void ParamEstimator::setMeasurements(const string &path, bool isHead)
+{
+  fstream file(path.c_str(), ios_base::in);
+  if (!file.is_open())
+    throw err.sendEx("file is not opened");
+
+  if (isHead)
+  {
+    string head;
+    getline(file, head);
+  }
+
+  vector<double> t, T;
+  double tv, Tv;
+  while (file >> tv >> Tv)
+  {
+    t.push_back(tv);
+    T.push_back(Tv);
+  }
+  file.close();
+
+  setMeasurements(t, T);
+}
+
+
+double ParamEstimator::fit(size_t max_iter, double tol)
+{
+  /*
+   * Returns RMS of the residuals, C.
+   * Repeated calls continue from the last parameters and damping.
+  */
+
+  if (params.empty())
+    throw err.sendEx("parameters to fit are not set");
+  if (t_meas.empty())
+    throw err.sendEx("measurements are not set");
+
+  size_t n = params.size();
+  vector<double> r = calcResiduals(p);
+  double cost = calcCost(r);
+
+  for (size_t it = 0; it < max_iter; ++it)
+  {
+    vector<vector<double> > J;
+    calcJacobian(r, J);
+
+    // Normal equations: (J^T J + lambda * diag(J^T J)) dp = -J^T r
+    vector<vector<double> > JtJ(n, vector<double>(n, 0.0));
+    vector<double> Jtr(n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < n; ++j)
+        for (size_t k = 0; k < r.size(); ++k)
+          JtJ[i][j] += J[i][k] * J[j][k];
+      for (size_t k = 0; k < r.size(); ++k)
+        Jtr[i] -= J[i][k] * r[k];
+    }
+
+    bool is_step = false;
+    while (!is_step && lambdaLM < 1e10)
+    {
+      vector<vector<double> > M = JtJ;
+      for (size_t i = 0; i < n; ++i)
+        M[i][i] += lambdaLM * ((JtJ[i][i] > 0.0) ? JtJ[i][i] : 1.0);
+
+      vector<double> dp;
+      if (!solveLinear(M, Jtr, dp))
+      {
+        lambdaLM *= 10.0;
+        continue;
+      }
+
+      vector<double> pc = p;
+      for (size_t i = 0; i < n; ++i)
+        pc[i] = max(params[i].min, min(params[i].max, p[i] + dp[i]));
+
+      vector<double> rc = calcResiduals(pc);
+      double cc = calcCost(rc);
+      if (cc < cost)
+      {
+        bool is_conv = (cost - cc) < tol * cost;
+        p = pc;
+        r = rc;
+        cost = cc;
+        lambdaLM = max(lambdaLM / 3.0, 1e-12);
+        is_step = true;
+        if (is_conv)
+          it = max_iter;
+      }
+      else
+        lambdaLM *= 2.0;
+    }
+    if (!is_step)
+      break;
+  }
+
+  for (size_t i = 0; i < n; ++i)
+    params[i].set(hc, p[i]);
+  rms = sqrt(2.0 * cost / r.size());
+  return rms;
+}
+
+
+const vector<double>& ParamEstimator::getParams() const
+{
+  return p;
+}
+
+
+const HeatCase& ParamEstimator::getCase() const
+{
+  return hc;
+}
+
+
+double ParamEstimator::getRMS() const
+{
+  return rms;
+}
+
+
+// *** PRIVATE ***
+vector<double> ParamEstimator::calcResiduals(const vector<double> &pv) const
+{
+  HeatCase c = hc;
+  for (size_t i = 0; i < params.size(); ++i)
+    params[i].set(c, pv[i]);
+
+  vector<double> t, Tw;
+  c.solve(t, Tw);
+
+  vector<double> r(t_meas.size());
+  for (size_t k = 0; k < t_meas.size(); ++k)
+    r[k] = interpSeries(t, Tw, t_meas[k]) - T_meas[k];
+  return r;
+}
+
+
+void ParamEstimator::calcJacobian(const vector<double> &r0,
+                                  vector<vector<double> > &J) const
+{
+  // J[i][k] = d r[k] / d p[i], the columns are solved concurrently
+
+  size_t n = params.size();
+  vector<double> h(n);
+  vector<future<vector<double> > > cols;
+  for (size_t i = 0; i < n; ++i)
+  {
+    vector<double> pi = p;
+    h[i] = 1e-4 * max(fabs(p[i]), 1e-6);
+    if (pi[i] + h[i] > params[i].max)
+      h[i] = -h[i];
+    pi[i] += h[i];
+    cols.push_back(async(launch::async, &ParamEstimator::calcResiduals,
+                         this, pi));
+  }
+
+  J.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    J[i] = cols[i].get();
+    for (size_t k = 0; k < J[i].size(); ++k)
+      J[i][k] = (J[i][k] - r0[k]) / h[i];
+  }
+}
+
+
+bool ParamEstimator::solveLinear(vector<vector<double> > M,
+                                 vector<double> v, vector<double> &x) const
+{
+  // Gauss elimination with partial pivoting (n is small)
+
+  size_t n = v.size();
+  for (size_t k = 0; k < n; ++k)
+  {
+    size_t piv = k;
+    for (size_t i = k + 1; i < n; ++i)
+      if (fabs(M[i][k]) > fabs(M[piv][k]))
+        piv = i;
+    if (fabs(M[piv][k]) < EPS)
+      return false;
+    swap(M[k], M[piv]);
+    swap(v[k], v[piv]);
+
+    for (size_t i = k + 1; i < n; ++i)
+    {
+      double w = M[i][k] / M[k][k];
+      for (size_t j = k; j < n; ++j)
+        M[i][j] -= w * M[k][j];
+      v[i] -= w * v[k];
+    }
+  }
+
+  x.assign(n, 0.0);
+  for (size_t k = n; k > 0; --k)
+  {
+    double s = v[k - 1];
+    for (size_t j = k; j < n; ++j)
+      s -= M[k - 1][j] * x[j];
+    x[k - 1] = s / M[k - 1][k - 1];
+  }
+  return true;
+}
+
+
+double ParamEstimator::calcCost(const vector<double> &r)
+{
+  double s = 0.0;
+  for (size_t k = 0; k < r.size(); ++k)
+    s += r[k] * r[k];
+  return 0.5 * s;
+}
@@ -0,0 +1,53 @@
+#ifndef PARAM_ESTIMATOR_H
+#define PARAM_ESTIMATOR_H
+
+#include <string>
+#include <vector>
+
+#include "err.h"
+#include "heat_case.h"
+
+
+/*
+ * Fitting of the case parameters to the measured Tw(t)
+ * by the Levenberg-Marquardt method. Jacobian columns
+ * (one perturbed solution per parameter) are computed in parallel.
+*/
+class ParamEstimator
+{
+private:
+  Error err;
+
+  HeatCase hc;                      // Case with the current parameters
+  std::vector<CaseParam> params;
+  std::vector<double> p;            // Current parameters (warm start)
+  std::vector<double> t_meas;       // Measured time, s
+  std::vector<double> T_meas;       // Measured wall temperature, C
+  double lambdaLM;                  // Damping of the last fit
+  double rms;                       // RMS of the last fit, C
+
+public:
+  explicit ParamEstimator(const HeatCase &c);
+
+  void addParam(const CaseParam &cp);
+  void setMeasurements(const std::vector<double> &t,
+                       const std::vector<double> &T_C);
+  void setMeasurements(const std::string &path, bool isHead);
+
+  double fit(size_t max_iter = 50, double tol = 1e-6);
+
+  const std::vector<double>& getParams() const;
+  const HeatCase& getCase() const;
+  double getRMS() const;
+
+private:
+  std::vector<double> calcResiduals(const std::vector<double> &pv) const;
+  void calcJacobian(const std::vector<double> &r0,
+                    std::vector<std::vector<double> > &J) const;
+  bool solveLinear(std::vector<std::vector<double> > M,
+                   std::vector<double> v, std::vector<double> &x) const;
+  static double calcCost(const std::vector<double> &r);
+};
+
+
+#endif // PARAM_ESTIMATOR_H
@@ -0,0 +1,207 @@
+#include "parareal.h"
+#include "env_model.h"
+
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <math.h>
+
+
+using namespace std;
+
+
+PararealSolver::PararealSolver(const HeatCase &c) :
+  hc(c), slicesN(0), coarseSteps(1), iterMax(0), tol(1e-6), threadsN(0),
+  iters(0), defect(0.0)
+{}
+
+
+void PararealSolver::setSlices(size_t n)
+{
+  // 0 - a slice per thread
+  slicesN = n;
+}
+
+
+void PararealSolver::setCoarseSteps(size_t n)
+{
+  if (n == 0)
+    throw err.sendEx("coarse propagator must have 1 step at least");
+  coarseSteps = n;
+}
+
+
+void PararealSolver::setIterations(size_t k_max, double tolerance)
+{
+  if (tolerance < 0.0)
+    throw err.sendEx("tolerance must be >= 0");
+  iterMax = k_max;
+  tol = tolerance;
+}
+
+
+void PararealSolver::setThreads(size_t n)
+{
+  // 0 - all the cores
+  threadsN = n;
+}
+
+
+void PararealSolver::solve(double horizon)
+{
+  /*
+   * Tw of the fine steps is recorded by the last fine sweep,
+   * and the series is cut at the termination of the case
+   * (Tw < Ta + delta_T or t_max) as the serial solution.
+  */
+
+  if (hc.dt <= 0.0)
+    throw err.sendEx("time step must be > 0");
+  if (horizon < hc.dt)
+    throw err.sendEx("horizon is shorter than the time step");
+
+  size_t tn = threadsN;
+  if (tn == 0)
+    tn = thread::hardware_concurrency();
+  if (tn == 0)
+    tn = 1;
+  size_t P = (slicesN == 0) ? tn : slicesN;
+
+  // Fine steps of the slices (the last one may be shorter)
+  size_t stepsN = size_t(ceil(horizon / hc.dt - 1e-9));
+  if (P > stepsN)
+    P = stepsN;
+  size_t per = (stepsN + P - 1) / P;
+  P = (stepsN + per - 1) / per;
+  vector<size_t> first(P + 1);
+  for (size_t p = 0; p <= P; ++p)
+    first[p] = (p * per < stepsN) ? p * per : stepsN;
+
+  // Both propagators are the solver's own step (a solver per thread)
+  ImplicitDiffSchemeCyl coarse;
+  hc.setup(coarse);
+  vector<unique_ptr<ImplicitDiffSchemeCyl> > fine;
+  for (size_t t = 0; t < tn && t < P; ++t)
+  {
+    fine.push_back(unique_ptr<ImplicitDiffSchemeCyl>(new ImplicitDiffSchemeCyl));
+    hc.setup(*fine.back());
+  }
+  vector<double> grid = coarse.getGrid();
+
+  double t0 = hc.sc.time;
+  auto sliceTime = [&](size_t p) { return t0 + first[p] * hc.dt; };
+  auto propagateG = [&](size_t p, const vector<double> &u) -> vector<double>
+  {
+    double dt = (first[p + 1] - first[p]) * hc.dt / coarseSteps;
+    propagate(coarse, grid, sliceTime(p), u, dt, coarseSteps);
+    return coarse.getField();
+  };
+
+  // Initial guess by the serial coarse sweep
+  vector<vector<double> > U(P + 1), G(P), F(P);
+  vector<vector<double> > Tw(P);
+  U[0] = coarse.getField();
+  for (size_t p = 0; p < P; ++p)
+  {
+    G[p] = propagateG(p, U[p]);
+    U[p + 1] = G[p];
+  }
+
+  size_t kMax = (iterMax == 0 || iterMax > P) ? P : iterMax;
+  for (iters = 0; iters < kMax; )
+  {
+    // Fine sweep: the slices from the first inexact one, in parallel
+    size_t p0 = iters;
+    size_t count = P - p0;
+    size_t workers = (fine.size() < count) ? fine.size() : count;
+    vector<thread> pool;
+    for (size_t w = 0; w < workers; ++w)
+      pool.push_back(thread([&, w]()
+      {
+        ImplicitDiffSchemeCyl &solver = *fine[w];
+        for (size_t p = p0 + w; p < P; p += workers)
+        {
+          propagate(solver, grid, sliceTime(p), U[p], hc.dt,
+                    first[p + 1] - first[p]);
+          Tw[p].assign(solver.getTw().begin() + 1, solver.getTw().end());
+          F[p] = solver.getField();
+        }
+      }));
+    for (size_t w = 0; w < pool.size(); ++w)
+      pool[w].join();
+    iters++;
+
+    // Serial coarse correction
+    defect = 0.0;
+    for (size_t p = p0; p < P; ++p)
+    {
+      vector<double> g = (p == p0) ? G[p] : propagateG(p, U[p]);
+      vector<double> u(g.size());
+      for (size_t i = 0; i < u.size(); ++i)
+      {
+        u[i] = g[i] + F[p][i] - G[p][i];
+        double d = fabs(u[i] - U[p + 1][i]);
+        if (d > defect)
+          defect = d;
+      }
+      G[p].swap(g);
+      U[p + 1].swap(u);
+    }
+    if (defect <= tol)
+      break;
+  }
+
+  // Series of the fine steps
+  EnvModel env(hc.Ta_C, hc.envPath);
+  double T_end = env.getTa() + hc.delta_T;
+  time_vec.assign(1, t0);
+  Tw_vec.assign(1, hc.sc.T0);
+  for (size_t p = 0; p < P; ++p)
+    for (size_t s = 0; s < Tw[p].size(); ++s)
+    {
+      if (Tw_vec.back() <= T_end || time_vec.back() >= hc.t_max)
+        return;
+      time_vec.push_back(sliceTime(p) + (s + 1) * hc.dt);
+      Tw_vec.push_back(Tw[p][s]);
+    }
+}
+
+
+void PararealSolver::propagate(ImplicitDiffSchemeCyl &solver,
+                               const vector<double> &grid, double t,
+                               const vector<double> &u, double dt,
+                               size_t n) const
+{
+  /*
+   * n steps from the field u (K) at the time t: the slice's start becomes
+   * the solver's start state. The steps aren't stopped by delta_T,
+   * the series is cut by solve(horizon).
+  */
+
+  StartConds sc = hc.sc;
+  sc.setGeometry(hc.walls, hc.sc.H);
+  sc.time = t;
+  solver.setStartConds(sc);
+
+  vector<double> T_C(u.size());
+  for (size_t i = 0; i < u.size(); ++i)
+    T_C[i] = u[i] - T_ABS;
+  solver.setStartProfile(grid, T_C);
+  solver.reset();
+
+  solver.setMaxTime(t + (n - 0.5) * dt);
+  solver.solve(dt, 0.0);
+}
+
+
+void PararealSolver::writeResultsFile(const string &path) const
+{
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("resulting file is not opened");
+
+  f << "t, sec\tT, C\n";
+  for (size_t i = 0; i < Tw_vec.size(); ++i)
+    f << time_vec[i] << '\t' << Tw_vec[i] - T_ABS << '\n';
+  f.close();
+}
@@ -0,0 +1,61 @@
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+#include <string>
+#include <vector>
+
+#include "err.h"
+#include "heat_case.h"
+
+
+/*
+ * Parallel-in-time solution of the case on the horizon [t0; t0 + T]:
+ * the horizon is cut into time slices, the fine propagator F (the solver's
+ * scheme with hc.dt) runs on all the slices concurrently and the cheap
+ * coarse propagator G (the same scheme with a few large steps per slice)
+ * corrects their start states serially:
+ *   U[p + 1] = G(U_new[p]) + F(U_old[p]) - G(U_old[p]).
+ * After k iterations the first k slices are exact, so the iterations stop
+ * at the tolerance of the slices' start states or after all the slices.
+*/
+class PararealSolver
+{
+private:
+  mutable Error err;
+
+  HeatCase hc;
+  size_t slicesN;               // 0 - number of the threads
+  size_t coarseSteps;           // Steps of G per slice
+  size_t iterMax;               // 0 - until all the slices are exact
+  double tol;                   // Max change of the start states, K
+  size_t threadsN;
+
+  size_t iters;                 // Iterations of the last solution
+  double defect;                // Max change of the last iteration
+  std::vector<double> time_vec;
+  std::vector<double> Tw_vec;
+
+public:
+  explicit PararealSolver(const HeatCase &c);
+
+  void setSlices(size_t n);
+  void setCoarseSteps(size_t n);
+  void setIterations(size_t k_max, double tolerance);
+  void setThreads(size_t n);
+
+  void solve(double horizon);
+
+  size_t getIterations() const { return iters; }
+  double getDefect() const { return defect; }
+  const std::vector<double>& getTime() const { return time_vec; }
+  const std::vector<double>& getTw() const { return Tw_vec; }
+  void writeResultsFile(const std::string &path) const;
+
+private:
+  void propagate(ImplicitDiffSchemeCyl &solver, const std::vector<double> &grid,
+                 double t, const std::vector<double> &u, double dt,
+                 size_t n) const;
+};
+
+
+#endif // PARAREAL_H
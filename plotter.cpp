@@ -1,6 +1,8 @@
 #include "plotter.h"
 
-#include <fstream>
+#include <QPointF>
+#include <QVector>
+
 #include <iostream>
 
 #include "mainwindow.h"
@@ -10,7 +12,8 @@ using namespace QtCharts;
 using namespace std;
 
 
-Plotter::Plotter() : isData(false)
+Plotter::Plotter() :
+  isData(false), isDirty(false), loader(nullptr), loadTimer(nullptr)
 {
   series = new QLineSeries();
   axisX = new QValueAxis();
@@ -20,6 +23,13 @@ Plotter::Plotter() : isData(false)
 }
 
 
+Plotter::~Plotter()
+{
+  delete loadTimer;
+  delete loader;
+}
+
+
 void Plotter::setData(const vector<double> &x, const vector<double> &y)
 {
   if (isData)
@@ -29,39 +39,131 @@ void Plotter::setData(const vector<double> &x, const vector<double> &y)
   if (size != y.size())
     throw err.sendEx("size of X != size of Y");
 
-  for (size_t i = 0; i < size; ++i)
-    series->append(x[i], y[i]);
+  data.append(x.data(), y.data(), size);
   isData = true;
+  redraw();
 }
 
 
 void Plotter::setData(const string &path, bool isHead)
 {
+  /*
+   * File is read and decimated on the worker thread,
+   * the chart shows the data as they arrive.
+  */
+
   if (isData)
     throw err.sendEx("data is already set");
 
-  fstream file(path.c_str(), ios_base::in);
-  if (!file.is_open())
-    throw err.sendEx("file is not opened");
+  loader = new ResultsLoader();
+  loader->start(path, isHead);
+  isData = true;
+
+  loadTimer = new QTimer();
+  QObject::connect(loadTimer, &QTimer::timeout, [this]() { takeLoaded(); });
+  loadTimer->start(50);
+}
+
 
-  if (isHead)
+void Plotter::takeLoaded()
+{
+  /*
+   * The pyramid is built by the loader's thread: the GUI only shows
+   * its latest decimated preview and swaps the ready pyramid in.
+  */
+
+  DecimPyramid *p = loader->takePyramid();
+  if (p)
   {
-    char buf[64];
-    file.getline(buf, 64, '\n');
+    loadTimer->stop();
+    data.swap(*p);
+    delete p;
+    redraw();
+    return;
   }
 
-  while (true)
-  {
-    double x, y;
-    file >> x >> y;
-    if (file.eof())
-      break;
+  LoadPreview pv;
+  bool is_new = false;
+  while (loader->pop(pv))
+    is_new = true;
+  if (is_new)
+    showPoints(pv.x, pv.y);
+}
 
-    series->append(x, y);
-  }
+
+void Plotter::addPoint(double x, double y)
+{
+  // Used for the live data (e.g. from the running solver),
+  // the chart is updated by refresh()
+
+  data.append(x, y);
   isData = true;
+  isDirty = true;
+}
 
-  file.close();
+
+void Plotter::refresh()
+{
+  if (isDirty)
+    redraw();
+}
+
+
+void Plotter::redraw()
+{
+  /*
+   * The series gets about two points (min and max) per pixel
+   * of the visible X range whatever the size of the data is.
+  */
+
+  isDirty = false;
+  if (data.size() == 0)
+    return;
+
+  double x1 = data.xMin();
+  double x2 = data.xMax();
+  QList<QAbstractAxis*> axes = chart->axes(Qt::Horizontal);
+  if (!axes.isEmpty())
+  {
+    QValueAxis *ax = qobject_cast<QValueAxis*>(axes.first());
+    if (ax)
+    {
+      x1 = ax->min();
+      x2 = ax->max();
+    }
+  }
+
+  size_t width = size_t(chart->plotArea().width());
+  if (width == 0)
+    width = 1000;
+
+  vector<double> xs, ys;
+  data.query(x1, x2, width, xs, ys);
+  showPoints(xs, ys);
+}
+
+
+void Plotter::showPoints(const vector<double> &xs, const vector<double> &ys)
+{
+  QVector<QPointF> points(int(xs.size()));
+  for (size_t i = 0; i < xs.size(); ++i)
+    points[int(i)] = QPointF(xs[i], ys[i]);
+  series->replace(points);
+}
+
+
+void Plotter::connectZoom()
+{
+  // Level of detail follows the zoom of the X axis
+
+  QList<QAbstractAxis*> axes = chart->axes(Qt::Horizontal);
+  if (axes.isEmpty())
+    return;
+  QValueAxis *ax = qobject_cast<QValueAxis*>(axes.first());
+  if (!ax)
+    return;
+  QObject::connect(ax, &QValueAxis::rangeChanged, [this]() { redraw(); });
+  chartView->setRubberBand(QChartView::HorizontalRubberBand);
 }
 
 
@@ -80,6 +182,8 @@ void Plotter::createChart(const QString &title)
 void Plotter::setAxis()
 {
   chart->createDefaultAxes();
+  connectZoom();
+  redraw();
 }
 
 
@@ -128,6 +232,9 @@ void Plotter::setAxis(double x_min, double x_max,
 
   series->attachAxis(axisX);
   series->attachAxis(axisY);
+
+  connectZoom();
+  redraw();
 }
 
 
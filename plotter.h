@@ -12,10 +12,13 @@
 #include <QPen>
 #include <QFont>
 #include <QString>
+#include <QTimer>
 
 #include <vector>
 
 #include "err.h"
+#include "decim_pyramid.h"
+#include "results_loader.h"
 
 
 class Plotter
@@ -30,17 +33,34 @@ private:
 
   bool isData;
 
+  // Only the decimated visible part of the data is given to the series
+  DecimPyramid data;
+  bool isDirty;           // Data were added after the last redrawing
+
+  // Background loading of the results file
+  ResultsLoader *loader;
+  QTimer *loadTimer;
+
 public:
   Plotter();
+  ~Plotter();
 
   void setData(const std::vector<double> &x, const std::vector<double> &y);
   void setData(const std::string &path, bool isHead);
+  void addPoint(double x, double y);
+  void refresh();
   void createChart(const QString &title = "");
   void setAxis();
   void setAxis(double x_min, double x_max,
                double y_min, double y_max,
                int x_ticks, int y_ticks);
   QtCharts::QChartView* getChartView();
+
+private:
+  void redraw();
+  void showPoints(const std::vector<double> &xs, const std::vector<double> &ys);
+  void takeLoaded();
+  void connectZoom();
 };
 
 
@@ -0,0 +1,331 @@
+#include "process_batch.h"
+
+#include <exception>
+#include <new>
+#include <thread>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+
+using namespace std;
+
+
+ProcessBatch::ProcessBatch() :
+  procsN(0), maxAttempts(2), timeout(0),
+  shm(nullptr), shmLen(0), queue(nullptr), slots(nullptr), entries(nullptr)
+{
+}
+
+
+ProcessBatch::~ProcessBatch()
+{
+  freeShared();
+}
+
+
+size_t ProcessBatch::addCase(const HeatCase &hc)
+{
+  // Returns the index of the case in the results
+
+  cases.push_back(hc);
+  cases.back().cache = nullptr;   // The cache's index isn't shared by the processes
+  return cases.size() - 1;
+}
+
+
+void ProcessBatch::setProcesses(size_t n)
+{
+  // 0 - all the cores
+  procsN = n;
+}
+
+
+void ProcessBatch::setRetries(int n)
+{
+  // Extra attempts of a case whose process died
+
+  if (n < 0)
+    throw err.sendEx("number of the retries must be >= 0");
+  maxAttempts = n + 1;
+}
+
+
+void ProcessBatch::setTimeout(unsigned sec)
+{
+  // The process is killed (SIGALRM) if the case runs longer (0 - off)
+  timeout = sec;
+}
+
+
+void ProcessBatch::run()
+{
+  if (cases.empty())
+    throw err.sendEx("cases are not added");
+
+  allocShared();
+  size_t n = cases.size();
+  for (size_t k = 0; k < n; ++k)
+    entries[k] = uint32_t(k);
+  queue->head.store(0);
+  queue->tail.store(n);
+
+  size_t pn = procsN;
+  if (pn == 0)
+    pn = thread::hardware_concurrency();
+  if (pn == 0)
+    pn = 1;
+  if (pn > n)
+    pn = n;
+
+  vector<pid_t> workers;
+  for (size_t i = 0; i < pn; ++i)
+    workers.push_back(startWorker());
+
+  while (!workers.empty())
+  {
+    // Only the batch's workers are waited for (other children are untouched)
+    bool is_exited = false;
+    for (size_t i = 0; i < workers.size(); )
+    {
+      int status;
+      pid_t pid = waitpid(workers[i], &status, WNOHANG);
+      if (pid == 0 || (pid < 0 && errno == EINTR))
+      {
+        i++;
+        continue;
+      }
+      if (pid < 0)
+        throw err.sendEx("waiting for the workers failed");
+
+      workers.erase(workers.begin() + i);
+      is_exited = true;
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        onWorkerDied(pid, status);
+    }
+
+    // Replacements for the cases queued again
+    while (workers.size() < pn && queue->head.load() < queue->tail.load())
+      workers.push_back(startWorker());
+
+    if (!is_exited && !workers.empty())
+      usleep(BATCH_POLL_US);
+  }
+}
+
+
+size_t ProcessBatch::size() const
+{
+  return cases.size();
+}
+
+
+const BatchSlot& ProcessBatch::getResult(size_t k) const
+{
+  if (!slots)
+    throw err.sendEx("batch is not run");
+  if (k >= cases.size())
+    throw err.sendEx("no such case");
+  return slots[k];
+}
+
+
+size_t ProcessBatch::getFailed() const
+{
+  if (!slots)
+    return 0;
+  size_t f = 0;
+  for (size_t k = 0; k < cases.size(); ++k)
+    if (slots[k].state.load() != CASE_DONE)
+      f++;
+  return f;
+}
+
+
+void ProcessBatch::writeReport(ostream &os) const
+{
+  if (!slots)
+    throw err.sendEx("batch is not run");
+
+  os << "\t..... BATCH .....\n"
+     << "\tcases: " << cases.size() << " (failed: " << getFailed() << ")\n"
+     << "\tcase\ttime, s\tTw, C\tsteps\tattempts\n";
+  for (size_t k = 0; k < cases.size(); ++k)
+  {
+    const BatchSlot &s = slots[k];
+    os << "\t#" << k + 1 << ".\t";
+    if (s.state.load() == CASE_DONE)
+      os << s.time << '\t' << s.Tw << '\t' << s.steps << '\t' << s.attempts << '\n';
+    else
+      os << "failed\t-\t-\t" << s.attempts << '\t' << s.message << '\n';
+  }
+  os << '\n';
+}
+
+
+// *** PRIVATE ***
+void ProcessBatch::allocShared()
+{
+  // Queue holds every case once plus its retries
+
+  freeShared();
+  size_t n = cases.size();
+  size_t cap = n * maxAttempts;
+  shmLen = sizeof(Queue) + n * sizeof(BatchSlot) + cap * sizeof(uint32_t);
+
+  shm = mmap(nullptr, shmLen, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shm == MAP_FAILED)
+  {
+    shm = nullptr;
+    throw err.sendEx("shared memory is not allocated");
+  }
+
+  char *p = static_cast<char*>(shm);
+  queue = new (p) Queue;
+  slots = reinterpret_cast<BatchSlot*>(p + sizeof(Queue));
+  for (size_t k = 0; k < n; ++k)
+  {
+    new (slots + k) BatchSlot;
+    slots[k].state.store(CASE_PENDING);
+    slots[k].attempts = 0;
+    slots[k].pid = 0;
+    slots[k].time = slots[k].Tw = 0.0;
+    slots[k].steps = 0;
+    slots[k].message[0] = '\0';
+  }
+  entries = reinterpret_cast<uint32_t*>(p + sizeof(Queue) + n * sizeof(BatchSlot));
+}
+
+
+void ProcessBatch::freeShared()
+{
+  if (shm)
+    munmap(shm, shmLen);
+  shm = nullptr;
+  shmLen = 0;
+  queue = nullptr;
+  slots = nullptr;
+  entries = nullptr;
+}
+
+
+pid_t ProcessBatch::startWorker()
+{
+  pid_t pid = fork();
+  if (pid < 0)
+    throw err.sendEx("worker process is not started");
+  if (pid == 0)
+  {
+    // No destructors and stdio flushes of the parent's objects in the child
+    signal(SIGALRM, SIG_DFL);
+    try
+    {
+      worker();
+    }
+    catch (...)
+    {
+      _exit(1);   // Must not unwind into the parent's run()
+    }
+    _exit(0);
+  }
+  return pid;
+}
+
+
+void ProcessBatch::worker()
+{
+  ImplicitDiffSchemeCyl solver;   // Reused by all the cases of the worker
+  vector<double> t, Tw_C;
+  uint32_t k;
+
+  while (takeCase(k))
+  {
+    BatchSlot &s = slots[k];
+    const HeatCase &c = cases[k];
+    s.attempts++;
+    s.pid = getpid();
+    s.state.store(CASE_RUNNING);
+
+    alarm(timeout);
+    try
+    {
+      c.solve(t, Tw_C, solver);
+      s.time = c.thresholdTime(t, Tw_C);
+      s.Tw = Tw_C.empty() ? 0.0 : Tw_C.back();
+      s.steps = t.size();
+      s.state.store(CASE_DONE);
+    }
+    catch (const string &e)
+    {
+      setMessage(s, e);
+      s.state.store(CASE_FAILED);
+    }
+    catch (const exception &e)
+    {
+      setMessage(s, e.what());
+      s.state.store(CASE_FAILED);
+    }
+    alarm(0);
+  }
+}
+
+
+bool ProcessBatch::takeCase(uint32_t &k)
+{
+  // The head never passes the tail, so the entries queued later are seen
+
+  uint64_t h = queue->head.load();
+  while (h < queue->tail.load())
+    if (queue->head.compare_exchange_weak(h, h + 1))
+    {
+      k = entries[h];
+      return true;
+    }
+  return false;
+}
+
+
+void ProcessBatch::onWorkerDied(pid_t pid, int status)
+{
+  // The case of the dead process is queued again or failed
+
+  for (size_t k = 0; k < cases.size(); ++k)
+  {
+    BatchSlot &s = slots[k];
+    if (s.state.load() != CASE_RUNNING || s.pid != pid)
+      continue;
+
+    if (s.attempts < maxAttempts)
+    {
+      s.state.store(CASE_PENDING);
+      uint64_t t = queue->tail.load();
+      entries[t] = uint32_t(k);
+      queue->tail.store(t + 1);
+    }
+    else
+    {
+      string msg = WIFSIGNALED(status) ?
+                     "process is killed by signal " + to_string(WTERMSIG(status)) :
+                     "process exited with code " + to_string(WEXITSTATUS(status));
+      setMessage(s, msg);
+      s.state.store(CASE_FAILED);
+    }
+    return;
+  }
+}
+
+
+void ProcessBatch::setMessage(BatchSlot &s, const string &msg)
+{
+  // Error messages are framed by the line breaks (see Error)
+
+  size_t b = msg.find_first_not_of("\n\t ");
+  size_t e = msg.find_last_not_of("\n\t ");
+  string m = (b == string::npos) ? string() : msg.substr(b, e - b + 1);
+  strncpy(s.message, m.c_str(), BATCH_MSG_LEN - 1);
+  s.message[BATCH_MSG_LEN - 1] = '\0';
+}
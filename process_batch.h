@@ -0,0 +1,101 @@
+#ifndef PROCESS_BATCH_H
+#define PROCESS_BATCH_H
+
+#include <atomic>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "err.h"
+#include "heat_case.h"
+
+#define BATCH_MSG_LEN 128   // Max length of the failure message
+#define BATCH_POLL_US 5000  // Period of the workers' status polling, us
+
+
+enum CaseState
+{
+  CASE_PENDING,
+  CASE_RUNNING,
+  CASE_DONE,
+  CASE_FAILED
+};
+
+
+// Result of one case (in the shared memory)
+struct BatchSlot
+{
+  std::atomic<int> state;     // CaseState
+  int attempts;               // Started solutions
+  int pid;                    // Process of the last attempt
+  double time;                // Time-to-threshold, s
+  double Tw;                  // Final wall outer temperature, C
+  uint64_t steps;             // Number of the time layers
+  char message[BATCH_MSG_LEN];
+};
+
+
+/*
+ * Batch of the cases solved by the forked worker processes (Linux,
+ * no external services). The queue of the cases' indices and the table
+ * of the results are in the shared anonymous mapping: the workers take
+ * the cases by CAS on the queue's head and write the results straight
+ * into the table. A case that throws is failed at once (the error
+ * repeats); a case whose process dies (crash, timeout) is queued again
+ * until the attempts are exhausted, a new worker replaces the dead one.
+ * The calling process must be single-threaded while run() forks.
+*/
+class ProcessBatch
+{
+private:
+  mutable Error err;
+
+  struct Queue
+  {
+    std::atomic<uint64_t> head;   // Next entry to take (workers)
+    std::atomic<uint64_t> tail;   // End of the entries (parent only)
+  };
+
+  std::vector<HeatCase> cases;
+  size_t procsN;
+  int maxAttempts;
+  unsigned timeout;             // Time limit of one case, s (0 - off)
+
+  void *shm;                    // Queue, slots, entries
+  size_t shmLen;
+  Queue *queue;
+  BatchSlot *slots;
+  uint32_t *entries;
+
+public:
+  ProcessBatch();
+  ~ProcessBatch();
+
+  ProcessBatch(const ProcessBatch&) = delete;
+  ProcessBatch& operator=(const ProcessBatch&) = delete;
+
+  size_t addCase(const HeatCase &hc);
+  void setProcesses(size_t n);
+  void setRetries(int n);
+  void setTimeout(unsigned sec);
+
+  void run();
+
+  size_t size() const;
+  const BatchSlot& getResult(size_t k) const;
+  size_t getFailed() const;
+  void writeReport(std::ostream &os) const;
+
+private:
+  void allocShared();
+  void freeShared();
+  pid_t startWorker();
+  void worker();
+  bool takeCase(uint32_t &k);
+  void onWorkerDied(pid_t pid, int status);
+  static void setMessage(BatchSlot &s, const std::string &msg);
+};
+
+
+#endif // PROCESS_BATCH_H
@@ -0,0 +1,138 @@
+#include "radial_layers.h"
+#include "scheme_coeffs.h"
+
+
+using namespace std;
+
+
+void RadialLayers::set(const Walls &ws)
+{
+  if (ws.empty())
+    throw err.sendEx("walls are empty");
+
+  walls.clear();
+  walls.insert(walls.end(), ws.begin(), ws.end());
+  r.clear();
+  wallOf.clear();
+  is_joint.clear();
+
+  for (size_t i = 0; i < walls.size(); ++i)
+  {
+    const Wall &w = walls[i];
+    if (!w.is_grid)
+      throw err.sendEx("grid of the wall is not set");
+    if (w.dataSize < 2)
+      throw err.sendEx("table of the wall must have 2 points at least");
+
+    for (size_t j = (i == 0) ? 0 : 1; j < w.N; ++j)
+    {
+      r.push_back(w.r[j]);
+      wallOf.push_back(i);
+      is_joint.push_back(j == w.N - 1 && i != walls.size() - 1);
+    }
+  }
+}
+
+
+double RadialLayers::lam(size_t wi, double T, gsl_interp_accel *acc) const
+{
+  const Wall &w = walls[wi];
+  return tableLookup(w.T_table, w.lambda, w.dataSize, T, acc);
+}
+
+
+double RadialLayers::c(size_t wi, double T, gsl_interp_accel *acc) const
+{
+  const Wall &w = walls[wi];
+  return tableLookup(w.T_table, w.c, w.dataSize, T, acc);
+}
+
+
+void RadialLayers::radialCoeffs(size_t i, const double *th, double dt,
+                                gsl_interp_accel *acc, double &A, double &B) const
+{
+  // Node's conductivities as in ImplicitDiffSchemeCyl, the rest is shared
+
+  size_t wi = wallOf[i];
+  double a1, a2;
+  if (is_joint[i])
+    a1 = a2 = jointDiffusivity(r[i] - r[i - 1], r[i + 1] - r[i],
+                               c(wi, th[i], acc) * walls[wi].rho,
+                               c(wi + 1, th[i + 1], acc) * walls[wi + 1].rho,
+                               lam(wi, th[i], acc), lam(wi + 1, th[i + 1], acc));
+  else
+  {
+    double crho = c(wi, th[i], acc) * walls[wi].rho;
+    a1 = lam(wi, 0.5 * (th[i] + th[i + 1]), acc) / crho;
+    a2 = lam(wi, 0.5 * (th[i - 1] + th[i]), acc) / crho;
+  }
+
+  radialAB(r.data(), i, dt, a1, a2, A, B);
+}
+
+
+double RadialLayers::lamNode(size_t i, double T, gsl_interp_accel *acc) const
+{
+  size_t wi = wallOf[i];
+  if (!is_joint[i])
+    return lam(wi, T, acc);
+
+  double h1 = r[i] - r[i - 1];
+  double h2 = r[i + 1] - r[i];
+  return (lam(wi, T, acc) * h1 + lam(wi + 1, T, acc) * h2) / (h1 + h2);
+}
+
+
+double RadialLayers::cRhoNode(size_t i, double T, gsl_interp_accel *acc) const
+{
+  size_t wi = wallOf[i];
+  if (!is_joint[i])
+    return c(wi, T, acc) * walls[wi].rho;
+
+  double h1 = r[i] - r[i - 1];
+  double h2 = r[i + 1] - r[i];
+  return (c(wi, T, acc) * walls[wi].rho * h1
+          + c(wi + 1, T, acc) * walls[wi + 1].rho * h2) / (h1 + h2);
+}
+
+
+double RadialLayers::boundKH(bool outer, const double *th,
+                             gsl_interp_accel *acc) const
+{
+  if (!outer)
+    return lam(0, th[0], acc) / (r[1] - r[0]);
+  size_t n = r.size() - 1;
+  return lam(walls.size() - 1, th[n], acc) / (r[n] - r[n - 1]);
+}
+
+
+void RadialLayers::boundRow(const BoundCond &bc, double th, double k_h,
+                            double al_conv, const EnvModel &env, double *rw) const
+{
+  // Rows of the bound policies of ImplicitDiffSchemeCyl
+
+  double al;
+  double Ta = bc.T_amb;
+  switch (bc.type)
+  {
+  case 1:
+    tempBoundRow(bc.T_w, rw);
+    return;
+  case 2:
+    fluxBoundRow(k_h, bc.q, rw);
+    return;
+  case 3:
+    if (bc.alpha < EPS)
+    {
+      Ta = env.getTa();
+      al = al_conv + env.alphaRad(th, Ta, epsilon());
+    }
+    else
+      al = bc.alpha;
+    break;
+  default:
+    al = env.alphaRad(th, Ta, epsilon());
+  }
+
+  convBoundRow(k_h, al, Ta, rw);
+}
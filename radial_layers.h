@@ -0,0 +1,77 @@
+#ifndef RADIAL_LAYERS_H
+#define RADIAL_LAYERS_H
+
+#include <gsl/gsl_interp.h>
+
+#include <vector>
+
+#include "types.h"
+#include "env_model.h"
+
+
+// Work memory of a thread for the tridiagonal line solves
+struct LineScratch
+{
+  std::vector<double> lo, di, up, f, x, line;
+  gsl_interp_accel *acc;    // Freed by the owner
+
+  LineScratch() : acc(nullptr) {}
+
+  void resize(size_t n)
+  {
+    lo.resize(n);
+    di.resize(n);
+    up.resize(n);
+    f.resize(n);
+    x.resize(n);
+    line.resize(n);
+  }
+};
+
+
+/*
+ * Walls on the common radial grid for the multidimensional solvers:
+ * materials of the nodes and the radial coefficients of the implicit
+ * scheme of ImplicitDiffSchemeCyl (the walls' tables are looked up
+ * linearly, as PROPS_TABLE). The formulas are the solver's ones
+ * (see scheme_coeffs.h).
+*/
+class RadialLayers
+{
+private:
+  Error err;
+
+  Walls walls;
+  std::vector<double> r;          // Common coordinates
+  std::vector<size_t> wallOf;     // Wall of the node (inner one for a joint)
+  std::vector<bool> is_joint;
+
+public:
+  void set(const Walls &ws);
+
+  size_t size() const { return r.size(); }
+  const std::vector<double>& coords() const { return r; }
+  double rOut() const { return r.back(); }
+  double epsilon() const { return walls.back().epsilon; }
+
+  double lam(size_t wi, double T, gsl_interp_accel *acc) const;
+  double c(size_t wi, double T, gsl_interp_accel *acc) const;
+
+  // A, B of the node i of the radial line th
+  void radialCoeffs(size_t i, const double *th, double dt,
+                    gsl_interp_accel *acc, double &A, double &B) const;
+  // Properties of the node i for the other directions
+  // (the joint's ones are averaged over its adjoining steps)
+  double lamNode(size_t i, double T, gsl_interp_accel *acc) const;
+  double cRhoNode(size_t i, double T, gsl_interp_accel *acc) const;
+  // lambda / step of the inner (i = 0) or outer (i = n - 1) bound cell
+  double boundKH(bool outer, const double *th, gsl_interp_accel *acc) const;
+
+  // Bound equation rw[0] * th[k] + rw[1] * th[k -+ 1] = rw[2]
+  // (al_conv - natural convection for type 3 without the set alpha)
+  void boundRow(const BoundCond &bc, double th, double k_h, double al_conv,
+                const EnvModel &env, double *rw) const;
+};
+
+
+#endif // RADIAL_LAYERS_H
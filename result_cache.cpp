@@ -0,0 +1,373 @@
+#include "result_cache.h"
+#include "mapped_series.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+
+using namespace std;
+
+
+#define CACHE_KEY_VERSION "NSHC1"   // Changes if the scheme's results change
+#define CACHE_EXT ".bin"
+#define CACHE_KEY_EXT ".key"       // Sidecar with the full key of the entry
+
+
+ResultCache::ResultCache(const string &dir_path, size_t max_bytes) :
+  dir(dir_path), maxBytes(max_bytes), totalBytes(0), clock(0),
+  hits(0), misses(0)
+{
+  if (dir.empty())
+    throw err.sendEx("cache directory is not set");
+
+  mkdir(dir.c_str(), 0755);
+  struct stat st;
+  if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    throw err.sendEx("cache directory is not created");
+
+  scanDir();
+  evict();
+}
+
+
+bool ResultCache::find(const HeatCase &hc, vector<double> &t, vector<double> &Tw_C)
+{
+  /*
+   * The hash only names the entry: a hit needs the same full key,
+   * so a collision of the hashes is a miss.
+  */
+
+  string key = makeKey(hc);
+  string name = makeName(key);
+
+  lock_guard<mutex> lock(mx);
+  map<string, Entry>::iterator it = index.find(name);
+  if (it == index.end() || readKey(name) != key)
+  {
+    misses++;
+    return false;
+  }
+
+  try
+  {
+    MappedSeries ms(entryPath(name));
+    t.assign(ms.x(), ms.x() + ms.size());
+    Tw_C.assign(ms.y(), ms.y() + ms.size());
+  }
+  catch (const string &)
+  {
+    // Damaged entry is removed
+    remove(entryPath(name).c_str());
+    remove(keyPath(name).c_str());
+    totalBytes -= it->second.size;
+    index.erase(it);
+    misses++;
+    return false;
+  }
+
+  it->second.tick = ++clock;
+  utime(entryPath(name).c_str(), nullptr);   // For the next sessions
+  hits++;
+  return true;
+}
+
+
+void ResultCache::store(const HeatCase &hc, const vector<double> &t,
+                        const vector<double> &Tw_C)
+{
+  /*
+   * The file is written under a temporary name and renamed,
+   * so other processes never see a partial entry.
+  */
+
+  string key = makeKey(hc);
+  string name = makeName(key);
+  string path = entryPath(name);
+  ostringstream tmp;
+  tmp << path << ".tmp" << getpid();
+
+  lock_guard<mutex> lock(mx);
+  writeKey(name, key);
+  MappedSeries::write(tmp.str(), t, Tw_C);
+  if (rename(tmp.str().c_str(), path.c_str()) != 0)
+  {
+    remove(tmp.str().c_str());
+    throw err.sendEx("cache entry is not written");
+  }
+
+  Entry e;
+  e.size = fileSize(path) + key.size();
+  e.tick = ++clock;
+  map<string, Entry>::iterator it = index.find(name);
+  if (it != index.end())
+    totalBytes -= it->second.size;
+  index[name] = e;
+  totalBytes += e.size;
+
+  evict();
+}
+
+
+void ResultCache::clear()
+{
+  lock_guard<mutex> lock(mx);
+  for (map<string, Entry>::iterator it = index.begin(); it != index.end(); ++it)
+  {
+    remove(entryPath(it->first).c_str());
+    remove(keyPath(it->first).c_str());
+  }
+  index.clear();
+  totalBytes = 0;
+}
+
+
+size_t ResultCache::getHits() const
+{
+  lock_guard<mutex> lock(mx);
+  return hits;
+}
+
+
+size_t ResultCache::getMisses() const
+{
+  lock_guard<mutex> lock(mx);
+  return misses;
+}
+
+
+size_t ResultCache::getBytes() const
+{
+  lock_guard<mutex> lock(mx);
+  return totalBytes;
+}
+
+
+void ResultCache::scanDir()
+{
+  // Entries of the previous sessions are ordered by the modification time
+
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    throw err.sendEx("cache directory is not opened");
+
+  vector<pair<time_t, string> > found;
+  size_t extLen = strlen(CACHE_EXT);
+  while (dirent *de = readdir(d))
+  {
+    string name = de->d_name;
+    if (name.size() <= extLen
+        || name.compare(name.size() - extLen, extLen, CACHE_EXT) != 0)
+      continue;
+
+    struct stat st;
+    if (stat((dir + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+
+    name.erase(name.size() - extLen);
+    Entry e;
+    e.size = size_t(st.st_size) + fileSize(keyPath(name));
+    e.tick = 0;
+    index[name] = e;
+    totalBytes += e.size;
+    found.push_back(make_pair(st.st_mtime, name));
+  }
+  closedir(d);
+
+  sort(found.begin(), found.end());
+  for (size_t i = 0; i < found.size(); ++i)
+    index[found[i].second].tick = ++clock;
+}
+
+
+void ResultCache::evict()
+{
+  while (totalBytes > maxBytes && !index.empty())
+  {
+    map<string, Entry>::iterator lru = index.begin();
+    for (map<string, Entry>::iterator it = index.begin(); it != index.end(); ++it)
+      if (it->second.tick < lru->second.tick)
+        lru = it;
+
+    remove(entryPath(lru->first).c_str());
+    remove(keyPath(lru->first).c_str());
+    totalBytes -= lru->second.size;
+    index.erase(lru);
+  }
+}
+
+
+string ResultCache::entryPath(const string &name) const
+{
+  return dir + "/" + name + CACHE_EXT;
+}
+
+
+string ResultCache::keyPath(const string &name) const
+{
+  return dir + "/" + name + CACHE_KEY_EXT;
+}
+
+
+string ResultCache::readKey(const string &name) const
+{
+  // Empty if the entry has no key (it's never equal to a key)
+
+  fstream f(keyPath(name).c_str(), ios_base::in | ios_base::binary);
+  if (!f.is_open())
+    return string();
+  ostringstream os;
+  os << f.rdbuf();
+  return os.str();
+}
+
+
+void ResultCache::writeKey(const string &name, const string &key) const
+{
+  ostringstream tmp;
+  tmp << keyPath(name) << ".tmp" << getpid();
+
+  fstream f(tmp.str().c_str(), ios_base::out | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("key of the cache entry is not written");
+  f.write(key.data(), key.size());
+  bool ok = f.good();
+  f.close();
+  if (!ok || rename(tmp.str().c_str(), keyPath(name).c_str()) != 0)
+  {
+    remove(tmp.str().c_str());
+    throw err.sendEx("key of the cache entry is not written");
+  }
+}
+
+
+size_t ResultCache::fileSize(const string &path)
+{
+  struct stat st;
+  return (stat(path.c_str(), &st) == 0) ? size_t(st.st_size) : 0;
+}
+
+
+string ResultCache::makeName(const string &key)
+{
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hashKey(key));
+  return buf;
+}
+
+
+uint64_t ResultCache::hashCase(const HeatCase &hc)
+{
+  return hashKey(makeKey(hc));
+}
+
+
+uint64_t ResultCache::hashKey(const string &key)
+{
+  // FNV-1a
+
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < key.size(); ++i)
+  {
+    h ^= uint64_t(static_cast<unsigned char>(key[i]));
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+
+string ResultCache::makeKey(const HeatCase &hc)
+{
+  /*
+   * Normalized input of the case: only the values affecting the solution,
+   * names, paths and the fields unused by the bound types are skipped
+   * (as the height H: the radial solution doesn't depend on it).
+  */
+
+  Error err;
+  string key = CACHE_KEY_VERSION;
+
+  for (size_t i = 0; i < hc.walls.size(); ++i)
+  {
+    const Wall &w = hc.walls[i];
+    if (!w.is_grid)
+      throw err.sendEx("grid of the wall is not set");
+
+    addKey(key, uint64_t(w.N));
+    for (size_t j = 0; j < w.N; ++j)
+      addKey(key, w.r[j]);
+    addKey(key, uint64_t(w.dataSize));
+    for (size_t j = 0; j < w.dataSize; ++j)
+    {
+      addKey(key, w.T_table[j]);
+      addKey(key, w.lambda[j]);
+      addKey(key, w.c[j]);
+    }
+    addKey(key, w.rho);
+  }
+  addKey(key, hc.walls.empty() ? 0.0 : hc.walls.back().epsilon);
+
+  const BoundCond *bs[2] = { &hc.bound1, &hc.bound2 };
+  for (int i = 0; i < 2; ++i)
+  {
+    addKey(key, uint64_t(bs[i]->type));
+    switch (bs[i]->type)
+    {
+    case 1:
+      addKey(key, bs[i]->T_w);
+      break;
+    case 2:
+      addKey(key, bs[i]->q);
+      break;
+    case 3:
+      addKey(key, bs[i]->T_amb);
+      addKey(key, bs[i]->alpha);
+      break;
+    default:
+      addKey(key, bs[i]->T_amb);
+    }
+  }
+
+  addKey(key, hc.sc.T0);
+  addKey(key, hc.sc.time);
+  addKey(key, hc.Ta_C);
+  addKey(key, hc.dt);
+  addKey(key, hc.delta_T);
+  addKey(key, hc.t_max);
+  if (hc.alphaTables)
+  {
+    addKey(key, hc.alphaTables->getTolerance());
+    addKey(key, hc.alphaTables->getTaStep());
+    addKey(key, hc.alphaTables->getDStep());
+  }
+
+  // Content of the environment table (not its path)
+  fstream f(hc.envPath.c_str(), ios_base::in | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("file is not opened");
+  ostringstream env;
+  env << f.rdbuf();
+  f.close();
+  key += env.str();
+  return key;
+}
+
+
+void ResultCache::addKey(string &key, double v)
+{
+  v += 0.0;   // -0 and 0 are the same
+  key.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+
+void ResultCache::addKey(string &key, uint64_t v)
+{
+  key.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
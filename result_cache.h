@@ -0,0 +1,74 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "err.h"
+#include "heat_case.h"
+
+
+/*
+ * Persistent store of the solved cases' Tw(t) (content-addressed).
+ * The key is the hash of the normalized input of the case: walls' grids
+ * and tables, the used fields of the bounds, start conditions, content
+ * of the environment table, dt and the termination. Each entry is
+ * a series file (see MappedSeries) named by the hash and a sidecar
+ * with the full key, which must match for a hit.
+ * The total size is limited, the least recently used entries are removed.
+ * Methods are thread-safe.
+*/
+class ResultCache
+{
+private:
+  mutable Error err;
+
+  struct Entry
+  {
+    size_t size;        // Size of the file, bytes
+    uint64_t tick;      // Time of the last access (logical)
+  };
+
+  std::string dir;
+  size_t maxBytes;
+  size_t totalBytes;
+  uint64_t clock;
+  std::map<std::string, Entry> index;
+  size_t hits, misses;
+  mutable std::mutex mx;
+
+public:
+  ResultCache(const std::string &dir_path, size_t max_bytes);
+
+  bool find(const HeatCase &hc, std::vector<double> &t,
+            std::vector<double> &Tw_C);
+  void store(const HeatCase &hc, const std::vector<double> &t,
+             const std::vector<double> &Tw_C);
+  void clear();
+
+  size_t getHits() const;
+  size_t getMisses() const;
+  size_t getBytes() const;
+
+  static uint64_t hashCase(const HeatCase &hc);
+
+private:
+  void scanDir();
+  void evict();
+  std::string entryPath(const std::string &name) const;
+  std::string keyPath(const std::string &name) const;
+  std::string readKey(const std::string &name) const;
+  void writeKey(const std::string &name, const std::string &key) const;
+  static size_t fileSize(const std::string &path);
+  static std::string makeKey(const HeatCase &hc);
+  static std::string makeName(const std::string &key);
+  static uint64_t hashKey(const std::string &key);
+  static void addKey(std::string &key, double v);
+  static void addKey(std::string &key, uint64_t v);
+};
+
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,152 @@
+#include "results_loader.h"
+
+#include <chrono>
+#include <fstream>
+#include <utility>
+#include <stdlib.h>
+
+
+using namespace std;
+
+
+#define LOAD_BLOCK (1 << 20)        // Bytes read at once
+#define LOAD_PREVIEW_MS 50          // Period of the previews
+#define LOAD_PREVIEW_BUCKETS 2048   // Min/max pairs of a preview
+
+
+ResultsLoader::ResultsLoader() :
+  previews(4), is_stop(false), is_done(false), pyramid(nullptr) {}
+
+
+ResultsLoader::~ResultsLoader()
+{
+  stop();
+  delete pyramid;
+}
+
+
+void ResultsLoader::start(const string &path, bool isHead)
+{
+  if (worker.joinable())
+    throw err.sendEx("loading is already started");
+
+  ifstream file(path.c_str(), ios_base::in);
+  if (!file.is_open())
+    throw err.sendEx("file is not opened");
+  file.close();
+
+  is_stop = false;
+  is_done = false;
+  delete pyramid;
+  pyramid = new DecimPyramid();
+  worker = thread(&ResultsLoader::load, this, path, isHead);
+}
+
+
+void ResultsLoader::stop()
+{
+  is_stop = true;
+  if (worker.joinable())
+    worker.join();
+}
+
+
+bool ResultsLoader::pop(LoadPreview &p)
+{
+  return previews.pop(p);
+}
+
+
+bool ResultsLoader::isDone() const
+{
+  return is_done.load();
+}
+
+
+DecimPyramid* ResultsLoader::takePyramid()
+{
+  // The whole series once the loading is done (the caller owns it), else null
+
+  if (!is_done.load())
+    return nullptr;
+  DecimPyramid *p = pyramid;
+  pyramid = nullptr;
+  return p;
+}
+
+
+void ResultsLoader::load(string path, bool isHead)
+{
+  ifstream file(path.c_str(), ios_base::in | ios_base::binary);
+  vector<char> block(LOAD_BLOCK);
+  string rest;                  // Incomplete line of the previous block
+  bool is_head = isHead;
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+  while (!is_stop && file)
+  {
+    file.read(block.data(), LOAD_BLOCK);
+    rest.append(block.data(), size_t(file.gcount()));
+
+    // At the end of file the last line may have no '\n'
+    size_t end = file ? rest.rfind('\n') : rest.size();
+    if (end == string::npos)
+      continue;
+
+    const char *p = rest.c_str();
+    const char *pe = p + end;
+    while (p < pe)
+    {
+      const char *eol = p;
+      while (eol < pe && *eol != '\n')
+        eol++;
+
+      if (is_head)
+        is_head = false;
+      else
+      {
+        char *e1, *e2;
+        double x = strtod(p, &e1);
+        double y = strtod(e1, &e2);
+        // strtod skips '\n' as a space: the pair must end in its line
+        if (e1 != p && e2 != e1 && e2 <= eol)
+        {
+          try
+          {
+            pyramid->append(x, y);
+          }
+          catch (const string &)
+          {
+            // Unordered x: the loaded part is kept
+            is_done = true;
+            return;
+          }
+        }
+      }
+      p = eol + 1;
+    }
+    rest.erase(0, (end < rest.size()) ? end + 1 : end);
+
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    if (t - t0 >= chrono::milliseconds(LOAD_PREVIEW_MS))
+    {
+      publish();
+      t0 = t;
+    }
+  }
+
+  is_done = true;
+}
+
+
+void ResultsLoader::publish()
+{
+  // The preview is dropped if the GUI is late (a newer one will follow)
+
+  if (pyramid->size() == 0)
+    return;
+  LoadPreview pv;
+  pyramid->query(pyramid->xMin(), pyramid->xMax(), LOAD_PREVIEW_BUCKETS,
+                 pv.x, pv.y);
+  previews.push(std::move(pv));
+}
@@ -0,0 +1,54 @@
+#ifndef RESULTS_LOADER_H
+#define RESULTS_LOADER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "err.h"
+#include "spsc_queue.h"
+#include "decim_pyramid.h"
+
+
+// Decimated view of the loaded part of the series (for the chart)
+struct LoadPreview
+{
+  std::vector<double> x, y;
+};
+
+
+/*
+ * Reads the results file "x y" (one point per line) on a worker thread
+ * by blocks and builds the decimation pyramid there. The GUI gets only
+ * the small decimated previews of the loaded part through the lock-free
+ * queue and, at the end, the whole pyramid by the pointer (no copying).
+*/
+class ResultsLoader
+{
+private:
+  Error err;
+
+  std::thread worker;
+  SpscQueue<LoadPreview> previews;
+  std::atomic<bool> is_stop;              // Loading is cancelled
+  std::atomic<bool> is_done;              // The pyramid is ready
+  DecimPyramid *pyramid;                  // Built by the worker
+
+public:
+  ResultsLoader();
+  ~ResultsLoader();
+
+  void start(const std::string &path, bool isHead);
+  void stop();
+  bool pop(LoadPreview &p);
+  bool isDone() const;
+  DecimPyramid* takePyramid();
+
+private:
+  void load(std::string path, bool isHead);
+  void publish();
+};
+
+
+#endif // RESULTS_LOADER_H
@@ -0,0 +1,91 @@
+#ifndef SCHEME_COEFFS_H
+#define SCHEME_COEFFS_H
+
+#include <gsl/gsl_interp.h>
+
+#include <cstddef>
+
+#include "dual.h"
+
+
+/*
+ * Coefficients of the implicit radial scheme shared by ImplicitDiffSchemeCyl
+ * and the multidimensional solvers (RadialLayers). The inner row is
+ * -B * th[i - 1] + (1 + A + B) * th[i] - A * th[i + 1] = th_old[i],
+ * the bound row is rw[0] * th[k] + rw[1] * th[k -+ 1] = rw[2].
+ * Real is double or Dual<N> (the sensitivities).
+*/
+
+
+// Linear lookup of the wall's table, the end segments are extrapolated
+template <class Real>
+Real tableLookup(const double *x, const Real *y, size_t n,
+                 const Real &T, gsl_interp_accel *acc)
+{
+  double Tv = valueOf(T);
+  size_t i = 0;
+  if (Tv >= x[n - 1])
+    i = n - 2;
+  else if (Tv > x[0])
+    i = gsl_interp_accel_find(acc, x, n, Tv);
+  return y[i] + (y[i + 1] - y[i]) * (T - x[i]) / (x[i + 1] - x[i]);
+}
+
+
+// A, B of the node i by the temperature conductivities of its right (a1)
+// and left (a2) halves (the grid may be non-uniform)
+template <class Real>
+void radialAB(const Real *r, size_t i, double dt,
+              const Real &a1, const Real &a2, Real &A, Real &B)
+{
+  A = a1 * dt * (r[i] + r[i + 1])
+      / (r[i] * (r[i + 1] - r[i]) * (r[i + 1] - r[i - 1]));
+  B = a2 * dt * (r[i] + r[i - 1])
+      / (r[i] * (r[i] - r[i - 1]) * (r[i + 1] - r[i - 1]));
+}
+
+
+// Temperature conductivity of the joint: c * rho is weighted by the
+// adjoining steps h1, h2, lambda is the mean of the walls
+template <class Real>
+Real jointDiffusivity(const Real &h1, const Real &h2,
+                      const Real &crho1, const Real &crho2,
+                      const Real &lam1, const Real &lam2)
+{
+  Real crho_ = (crho1 * h1 + crho2 * h2) / (h1 + h2);
+  Real lam_ = 0.5 * (lam1 + lam2);
+  return lam_ / crho_;
+}
+
+
+// *** Bound rows (k_h - lambda / step of the bound cell) ***
+template <class Real>
+void tempBoundRow(double T_w, Real *rw)         // Type 1
+{
+  rw[0] = 1.0;
+  rw[1] = 0.0;
+  rw[2] = T_w;
+}
+
+
+template <class Real>
+void fluxBoundRow(const Real &k_h, double q, Real *rw)    // Type 2
+{
+  rw[0] = k_h;
+  rw[1] = -k_h;
+  rw[2] = q;
+}
+
+
+template <class Real>
+void convBoundRow(const Real &k_h, const Real &al, double Ta, Real *rw)
+{
+  // Types 3 and 4: alpha of the convection and (or) radiation
+  rw[0] = k_h + al;
+  rw[1] = -k_h;
+  rw[2] = al * Ta;
+}
+// *** END OF Bound rows ***
+
+
+#endif // SCHEME_COEFFS_H
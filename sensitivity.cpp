@@ -0,0 +1,178 @@
+#include "sensitivity.h"
+
+#include <fstream>
+
+
+using namespace std;
+
+
+SensitivityAnalyzer::SensitivityAnalyzer(const HeatCase &c) : hc(c) {}
+
+
+void SensitivityAnalyzer::addParam(const CaseParam &cp)
+{
+  if (params.size() == SENS_MAX_PARAMS)
+    throw err.sendEx("too many parameters for one pass");
+  cp.get(hc);   // Checks the parameter
+  params.push_back(cp);
+}
+
+
+void SensitivityAnalyzer::solve()
+{
+  /*
+   * The solver's own scheme (serial sweep) runs on the dual numbers;
+   * the termination is the same as in ImplicitDiffSchemeCyl::solve.
+   * The alpha table isn't used: it has no derivatives.
+  */
+
+  if (params.empty())
+    throw err.sendEx("parameters are not set");
+  if (hc.dt <= 0.0)
+    throw err.sendEx("time step must be > 0");
+
+  ImplicitDiffSchemeCyl solver;
+  SchemeStore<SensReal> s;
+  hc.setup(solver);
+  solver.initScheme(s);
+  for (size_t k = 0; k < params.size(); ++k)
+    seed(s, params[k], k);
+
+  t.clear();
+  Tw.clear();
+  dTw.assign(params.size(), vector<double>());
+
+  double time = hc.sc.time;
+  double T_end = hc.Ta_C + T_ABS + hc.delta_T;
+  while (true)
+  {
+    const SensReal &T = s.theta.back();
+    t.push_back(time);
+    Tw.push_back(T.v - T_ABS);
+    for (size_t k = 0; k < params.size(); ++k)
+      dTw[k].push_back(T.d[k]);
+
+    if (T.v <= T_end || time >= hc.t_max)
+      break;
+    solver.stepScheme(hc.dt, s);
+    time += hc.dt;
+  }
+}
+
+
+const vector<double>& SensitivityAnalyzer::getTime() const
+{
+  return t;
+}
+
+
+const vector<double>& SensitivityAnalyzer::getTw() const
+{
+  return Tw;
+}
+
+
+const vector<double>& SensitivityAnalyzer::getSens(size_t k) const
+{
+  if (k >= dTw.size())
+    throw err.sendEx("no sensitivity of this parameter");
+  return dTw[k];
+}
+
+
+void SensitivityAnalyzer::writeResultsFile(const string &path) const
+{
+  fstream f(path.c_str(), ios_base::out);
+  if (!f.is_open())
+    throw err.sendEx("resulting file is not opened");
+
+  f << "t, sec\tT, C";
+  for (size_t k = 0; k < dTw.size(); ++k)
+    f << "\tdT/dp" << k + 1;
+  f << '\n';
+  for (size_t j = 0; j < t.size(); ++j)
+  {
+    f << t[j] << '\t' << Tw[j];
+    for (size_t k = 0; k < dTw.size(); ++k)
+      f << '\t' << dTw[k][j];
+    f << '\n';
+  }
+
+  f.close();
+}
+
+
+// *** PRIVATE ***
+void SensitivityAnalyzer::seed(SchemeStore<SensReal> &s, const CaseParam &cp,
+                               size_t k) const
+{
+  // The parameter becomes the k-th independent variable
+
+  SchemeVars<SensReal> &v = s.v;
+  if (cp.kind == PAR_ALPHA)
+  {
+    seedDual(v.alpha2, k, 1.0);
+    return;
+  }
+
+  const Walls &ws = hc.walls;
+  if (cp.wall >= ws.size())
+    throw err.sendEx("wall of the parameter doesn't exist");
+  if ((cp.kind == PAR_LAMBDA || cp.kind == PAR_C) &&
+      cp.index >= ws[cp.wall].dataSize)
+    throw err.sendEx("table index of the parameter is out of the table");
+
+  switch (cp.kind)
+  {
+  case PAR_EPSILON:
+    // Only the outer wall radiates
+    if (cp.wall == ws.size() - 1)
+      seedDual(v.eps, k, 1.0);
+    break;
+  case PAR_RHO:
+    seedDual(v.rho[cp.wall], k, 1.0);
+    break;
+  case PAR_LAMBDA:
+    seedDual(s.lam[cp.wall][cp.index], k, 1.0);
+    break;
+  case PAR_C:
+    seedDual(s.c[cp.wall][cp.index], k, 1.0);
+    break;
+  default:
+    seedRadius(s, cp.wall, k);
+  }
+}
+
+
+void SensitivityAnalyzer::seedRadius(SchemeStore<SensReal> &s, size_t wi,
+                                     size_t k) const
+{
+  // Nodes move as in CaseParam::set (the grids are stretched linearly)
+
+  const Walls &ws = hc.walls;
+  vector<size_t> iEnd(ws.size());     // Common index of the wall's outer node
+  size_t n = 0;
+  for (size_t i = 0; i < ws.size(); ++i)
+  {
+    n += ws[i].N - 1;
+    iEnd[i] = n;
+  }
+
+  vector<SensReal> &r = s.r;
+  size_t i1 = (wi == 0) ? 0 : iEnd[wi - 1];
+  size_t i2 = iEnd[wi];
+  double r1 = r[i1].v;
+  double R = r[i2].v;
+  for (size_t i = i1 + 1; i <= i2; ++i)
+    seedDual(r[i], k, (r[i].v - r1) / (R - r1));
+
+  if (wi == ws.size() - 1)
+  {
+    seedDual(s.v.rOut, k, 1.0);
+    return;
+  }
+
+  double r2 = r[iEnd[wi + 1]].v;
+  for (size_t i = i2 + 1; i < iEnd[wi + 1]; ++i)
+    seedDual(r[i], k, (r2 - r[i].v) / (r2 - R));
+}
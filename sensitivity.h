@@ -0,0 +1,50 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include <string>
+#include <vector>
+
+#include "err.h"
+#include "dual.h"
+#include "heat_case.h"
+
+#define SENS_MAX_PARAMS 8   // Max number of parameters of one pass
+
+typedef Dual<SENS_MAX_PARAMS> SensReal;
+
+
+/*
+ * Sensitivities dTw/dp of the outer wall temperature to the case
+ * parameters by the forward-mode dual numbers: a single solution
+ * of the solver's scheme on Dual (ImplicitDiffSchemeCyl::initScheme)
+ * gives Tw(t) and all the derivatives (no perturbed solutions).
+*/
+class SensitivityAnalyzer
+{
+private:
+  mutable Error err;
+
+  HeatCase hc;
+  std::vector<CaseParam> params;
+  std::vector<double> t;                  // Time, s
+  std::vector<double> Tw;                 // Wall outer temperature, C
+  std::vector<std::vector<double> > dTw;  // dTw[k][j] = dTw/dp_k at t[j]
+
+public:
+  explicit SensitivityAnalyzer(const HeatCase &c);
+
+  void addParam(const CaseParam &cp);
+  void solve();
+
+  const std::vector<double>& getTime() const;
+  const std::vector<double>& getTw() const;
+  const std::vector<double>& getSens(size_t k) const;
+  void writeResultsFile(const std::string &path) const;
+
+private:
+  void seed(SchemeStore<SensReal> &s, const CaseParam &cp, size_t k) const;
+  void seedRadius(SchemeStore<SensReal> &s, size_t wi, size_t k) const;
+};
+
+
+#endif // SENSITIVITY_H
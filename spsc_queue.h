@@ -0,0 +1,62 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+
+// *** Lock-free single-producer single-consumer ring buffer ***
+template <class T>
+class SpscQueue
+{
+private:
+  std::vector<T> buf;
+  std::atomic<size_t> head;   // Next index to pop (consumer)
+  std::atomic<size_t> tail;   // Next index to push (producer)
+
+public:
+  explicit SpscQueue(size_t capacity) :
+    buf(capacity + 1), head(0), tail(0) {}
+
+  bool push(const T &v)
+  {
+    // Returns false (the item is dropped) if the queue is full
+
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t next = (t + 1) % buf.size();
+    if (next == head.load(std::memory_order_acquire))
+      return false;
+    buf[t] = v;
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool push(T &&v)
+  {
+    // Moves v in (v is untouched if the queue is full)
+
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t next = (t + 1) % buf.size();
+    if (next == head.load(std::memory_order_acquire))
+      return false;
+    buf[t] = std::move(v);
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &v)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    v = std::move(buf[h]);
+    head.store((h + 1) % buf.size(), std::memory_order_release);
+    return true;
+  }
+};
+// *** END OF SpscQueue ***
+
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,454 @@
+#include "surrogate.h"
+#include "result_cache.h"
+
+#include <fstream>
+#include <thread>
+#include <string.h>
+#include <math.h>
+
+#define SURR_MAGIC "NSHM"
+#define SURR_VERSION 1
+
+
+using namespace std;
+
+
+SurrogateModel::SurrogateModel(const HeatCase &c) :
+  hc(c), threadsN(0), failed(0), censored(0), fallbacks(0),
+  sampleInd(0), samplesN(0), qrng(nullptr)
+{
+}
+
+
+SurrogateModel::~SurrogateModel()
+{
+  if (qrng)
+    gsl_qrng_free(qrng);
+}
+
+
+void SurrogateModel::addParam(const CaseParam &cp)
+{
+  // [min; max] of the parameter is the range of the training
+
+  if (cp.min == -HUGE_VAL || cp.max == HUGE_VAL || cp.max <= cp.min)
+    throw err.sendEx("range of the parameter is not set");
+  cp.get(hc);   // Checks the parameter
+  params.push_back(cp);
+  X.clear();
+}
+
+
+void SurrogateModel::setThreads(size_t n)
+{
+  // 0 - all the cores
+  threadsN = n;
+}
+
+
+void SurrogateModel::train(size_t n)
+{
+  /*
+   * n solutions at the Sobol points; the failed and the censored
+   * ones are skipped. The previous model is replaced.
+  */
+
+  size_t d = params.size();
+  if (d == 0)
+    throw err.sendEx("parameters are not set");
+  if (d > 40)
+    throw err.sendEx("too many parameters for the Sobol sequence");
+  if (n < d + 2)
+    throw err.sendEx("too few training points");
+
+  X.assign(n, vector<double>(d));
+  y.assign(n, NAN);
+  cens.assign(n, 0);
+  sampleInd = 0;
+  samplesN = n;
+  if (qrng)
+    gsl_qrng_free(qrng);
+  qrng = gsl_qrng_alloc(gsl_qrng_sobol, d);
+
+  size_t tn = threadsN;
+  if (tn == 0)
+    tn = thread::hardware_concurrency();
+  if (tn == 0)
+    tn = 1;
+  if (tn > n)
+    tn = n;
+
+  vector<thread> pool;
+  for (size_t t = 0; t < tn; ++t)
+    pool.push_back(thread(&SurrogateModel::worker, this));
+  for (size_t t = 0; t < pool.size(); ++t)
+    pool[t].join();
+
+  gsl_qrng_free(qrng);
+  qrng = nullptr;
+
+  // Failed and censored points are removed
+  // (in order, so the model is reproducible)
+  size_t k = 0;
+  censored = 0;
+  for (size_t j = 0; j < n; ++j)
+    if (cens[j])
+      censored++;
+    else if (!isnan(y[j]))
+    {
+      X[k] = X[j];
+      y[k] = y[j];
+      k++;
+    }
+  failed = n - k - censored;
+  X.resize(k);
+  y.resize(k);
+  cens.clear();
+  if (k < d + 2)
+    throw err.sendEx("too many failed or censored training solutions");
+
+  fit();
+  fallbacks = 0;
+}
+
+
+void SurrogateModel::save(const string &path) const
+{
+  if (X.empty())
+    throw err.sendEx("model is not trained");
+
+  fstream f(path.c_str(), ios_base::out | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("model file is not opened");
+
+  char head[8] = { 0 };
+  memcpy(head, SURR_MAGIC, 4);
+  uint32_t version = SURR_VERSION;
+  memcpy(head + 4, &version, sizeof(version));
+  f.write(head, sizeof(head));
+
+  size_t d = params.size();
+  uint64_t u[3] = { d, X.size(), ResultCache::hashCase(hc) };
+  f.write(reinterpret_cast<const char*>(u), sizeof(u));
+  for (size_t i = 0; i < d; ++i)
+  {
+    uint64_t pu[3] = { uint64_t(params[i].kind), params[i].wall, params[i].index };
+    double pd[2] = { params[i].min, params[i].max };
+    f.write(reinterpret_cast<const char*>(pu), sizeof(pu));
+    f.write(reinterpret_cast<const char*>(pd), sizeof(pd));
+  }
+  for (size_t j = 0; j < X.size(); ++j)
+    f.write(reinterpret_cast<const char*>(X[j].data()), d * sizeof(double));
+  f.write(reinterpret_cast<const char*>(y.data()), y.size() * sizeof(double));
+  f.write(reinterpret_cast<const char*>(w.data()), w.size() * sizeof(double));
+  f.write(reinterpret_cast<const char*>(looErr.data()),
+          looErr.size() * sizeof(double));
+
+  if (!f.good())
+    throw err.sendEx("model file is not written");
+  f.close();
+}
+
+
+void SurrogateModel::load(const string &path)
+{
+  /*
+   * The parameters must be added as for the training
+   * and the base case must be the same.
+  */
+
+  fstream f(path.c_str(), ios_base::in | ios_base::binary);
+  if (!f.is_open())
+    throw err.sendEx("model file is not opened");
+
+  char head[8];
+  uint32_t version;
+  f.read(head, sizeof(head));
+  memcpy(&version, head + 4, sizeof(version));
+  if (!f || memcmp(head, SURR_MAGIC, 4) != 0 || version != SURR_VERSION)
+    throw err.sendEx("file is not a surrogate model");
+
+  size_t d = params.size();
+  uint64_t u[3];
+  f.read(reinterpret_cast<char*>(u), sizeof(u));
+  if (!f || u[0] != d)
+    throw err.sendEx("model has other parameters");
+  if (u[2] != ResultCache::hashCase(hc))
+    throw err.sendEx("model is trained for another case");
+  for (size_t i = 0; i < d; ++i)
+  {
+    uint64_t pu[3];
+    double pd[2];
+    f.read(reinterpret_cast<char*>(pu), sizeof(pu));
+    f.read(reinterpret_cast<char*>(pd), sizeof(pd));
+    if (!f || pu[0] != uint64_t(params[i].kind) || pu[1] != params[i].wall ||
+        pu[2] != params[i].index || pd[0] != params[i].min ||
+        pd[1] != params[i].max)
+      throw err.sendEx("model has other parameters");
+  }
+
+  size_t n = u[1];
+  X.assign(n, vector<double>(d));
+  y.resize(n);
+  w.resize(n + d + 1);
+  looErr.resize(n);
+  for (size_t j = 0; j < n; ++j)
+    f.read(reinterpret_cast<char*>(X[j].data()), d * sizeof(double));
+  f.read(reinterpret_cast<char*>(y.data()), n * sizeof(double));
+  f.read(reinterpret_cast<char*>(w.data()), w.size() * sizeof(double));
+  f.read(reinterpret_cast<char*>(looErr.data()), n * sizeof(double));
+  if (!f)
+  {
+    X.clear();
+    throw err.sendEx("model file is truncated");
+  }
+  f.close();
+
+  failed = censored = fallbacks = 0;
+}
+
+
+double SurrogateModel::predict(const vector<double> &p, double *err_est) const
+{
+  /*
+   * The error estimate is HUGE_VAL out of the training ranges
+   * (no extrapolation).
+  */
+
+  if (X.empty())
+    throw err.sendEx("model is not trained");
+  size_t d = params.size();
+  if (p.size() != d)
+    throw err.sendEx("wrong number of the parameters");
+
+  vector<double> x(d);
+  scale(p, x);
+  size_t n = X.size();
+
+  double v = w[n];
+  for (size_t i = 0; i < d; ++i)
+    v += w[n + 1 + i] * x[i];
+  double sw = 0.0, se = 0.0;
+  bool is_node = false;
+  for (size_t j = 0; j < n; ++j)
+  {
+    double r2 = 0.0;
+    for (size_t i = 0; i < d; ++i)
+      r2 += (x[i] - X[j][i]) * (x[i] - X[j][i]);
+    v += w[j] * r2 * sqrt(r2);
+
+    if (r2 < EPS * EPS)
+      is_node = true;
+    else
+    {
+      sw += 1.0 / r2;
+      se += fabs(looErr[j]) / r2;
+    }
+  }
+
+  if (err_est)
+  {
+    bool is_in = true;
+    for (size_t i = 0; i < d; ++i)
+      if (x[i] < -EPS || x[i] > 1.0 + EPS)
+        is_in = false;
+    if (!is_in)
+      *err_est = HUGE_VAL;
+    else
+      *err_est = is_node ? 0.0 : se / sw;
+  }
+  return v;
+}
+
+
+double SurrogateModel::query(const vector<double> &p, double tol)
+{
+  /*
+   * The model's value if its error estimate is within tol, else the solution
+   * (t_max if the solution is censored, as HeatCase::thresholdTime gives).
+  */
+
+  double e;
+  double v = predict(p, &e);
+  if (e <= tol)
+    return v;
+
+  fallbacks++;
+  bool is_cens;
+  return calcTime(p, is_cens);
+}
+
+
+size_t SurrogateModel::size() const
+{
+  return X.size();
+}
+
+
+size_t SurrogateModel::getFailed() const
+{
+  return failed;
+}
+
+
+size_t SurrogateModel::getCensored() const
+{
+  return censored;
+}
+
+
+size_t SurrogateModel::getFallbacks() const
+{
+  return fallbacks;
+}
+
+
+double SurrogateModel::getLooRMS() const
+{
+  if (looErr.empty())
+    return 0.0;
+  double s = 0.0;
+  for (size_t j = 0; j < looErr.size(); ++j)
+    s += looErr[j] * looErr[j];
+  return sqrt(s / looErr.size());
+}
+
+
+// *** PRIVATE ***
+void SurrogateModel::worker()
+{
+  size_t d = params.size();
+  vector<double> u(d), pv(d);
+  size_t j;
+
+  while (true)
+  {
+    {
+      lock_guard<mutex> lock(sampleMx);
+      if (sampleInd == samplesN)
+        return;
+      j = sampleInd++;
+      gsl_qrng_get(qrng, u.data());
+    }
+
+    for (size_t i = 0; i < d; ++i)
+      pv[i] = params[i].min + (params[i].max - params[i].min) * u[i];
+    X[j] = u;
+    try
+    {
+      bool is_cens;
+      double v = calcTime(pv, is_cens);
+      if (is_cens)
+        cens[j] = 1;
+      else
+        y[j] = v;
+    }
+    catch (const string &) {}   // NaN - failed
+    catch (const exception &) {}
+  }
+}
+
+
+double SurrogateModel::calcTime(const vector<double> &pv, bool &is_censored) const
+{
+  HeatCase c = hc;
+  for (size_t i = 0; i < params.size(); ++i)
+    params[i].set(c, pv[i]);
+
+  vector<double> t, Tw_C;
+  c.solve(t, Tw_C);
+  is_censored = Tw_C.empty() || Tw_C.back() > c.Ta_C + c.delta_T;
+  return c.thresholdTime(t, Tw_C);
+}
+
+
+void SurrogateModel::scale(const vector<double> &p, vector<double> &x) const
+{
+  for (size_t i = 0; i < params.size(); ++i)
+    x[i] = (p[i] - params[i].min) / (params[i].max - params[i].min);
+}
+
+
+void SurrogateModel::fit()
+{
+  /*
+   * [Phi P; P^T 0] [w; c] = [y; 0] is solved by the inverse,
+   * which gives the leave-one-out errors too: e_j = w_j / inv_jj.
+  */
+
+  size_t n = X.size();
+  size_t d = params.size();
+  size_t m = n + d + 1;
+
+  vector<vector<double> > M(m, vector<double>(m, 0.0));
+  for (size_t j = 0; j < n; ++j)
+  {
+    for (size_t k = 0; k < j; ++k)
+      M[j][k] = M[k][j] = phi(X[j], X[k]);
+    M[j][n] = M[n][j] = 1.0;
+    for (size_t i = 0; i < d; ++i)
+      M[j][n + 1 + i] = M[n + 1 + i][j] = X[j][i];
+  }
+  if (!invert(M))
+    throw err.sendEx("training points are degenerate");
+
+  w.assign(m, 0.0);
+  for (size_t k = 0; k < m; ++k)
+    for (size_t j = 0; j < n; ++j)
+      w[k] += M[k][j] * y[j];
+
+  looErr.resize(n);
+  for (size_t j = 0; j < n; ++j)
+    looErr[j] = w[j] / M[j][j];
+}
+
+
+double SurrogateModel::phi(const vector<double> &x1, const vector<double> &x2)
+{
+  // Cubic RBF
+  double r2 = 0.0;
+  for (size_t i = 0; i < x1.size(); ++i)
+    r2 += (x1[i] - x2[i]) * (x1[i] - x2[i]);
+  return r2 * sqrt(r2);
+}
+
+
+bool SurrogateModel::invert(vector<vector<double> > &M)
+{
+  // Gauss-Jordan elimination with partial pivoting (in place)
+
+  size_t n = M.size();
+  vector<size_t> col(n);
+  for (size_t k = 0; k < n; ++k)
+  {
+    size_t piv = k;
+    for (size_t i = k + 1; i < n; ++i)
+      if (fabs(M[i][k]) > fabs(M[piv][k]))
+        piv = i;
+    if (fabs(M[piv][k]) < EPS)
+      return false;
+    swap(M[k], M[piv]);
+    col[k] = piv;
+
+    double inv = 1.0 / M[k][k];
+    M[k][k] = 1.0;
+    for (size_t j = 0; j < n; ++j)
+      M[k][j] *= inv;
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (i == k || M[i][k] == 0.0)
+        continue;
+      double f = M[i][k];
+      M[i][k] = 0.0;
+      for (size_t j = 0; j < n; ++j)
+        M[i][j] -= f * M[k][j];
+    }
+  }
+
+  // Row swaps are undone as the column swaps in reverse order
+  for (size_t k = n; k-- > 0; )
+    if (col[k] != k)
+      for (size_t i = 0; i < n; ++i)
+        swap(M[i][k], M[i][col[k]]);
+  return true;
+}
@@ -0,0 +1,84 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <gsl/gsl_qrng.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "err.h"
+#include "heat_case.h"
+
+
+/*
+ * Fast model of the time-to-threshold as a function of the case
+ * parameters (within [min; max] of each CaseParam). It's trained
+ * by the solutions at the Sobol points: cubic RBF interpolation
+ * with the linear tail in the scaled parameters.
+ * The error estimate of a query is the inverse distance weighted
+ * leave-one-out error of the training points (Rippa's formula);
+ * query() solves the case if the estimate exceeds the tolerance.
+ * The censored training solutions (the threshold isn't reached
+ * by t_max) are counted apart and left out of the model.
+*/
+class SurrogateModel
+{
+private:
+  mutable Error err;
+
+  HeatCase hc;
+  std::vector<CaseParam> params;
+  size_t threadsN;
+
+  // Model
+  std::vector<std::vector<double> > X;    // Training points scaled to [0; 1]
+  std::vector<double> y;                  // Time-to-threshold, s
+  std::vector<char> cens;                 // Censored training points
+  std::vector<double> w;                  // RBF weights and linear tail
+  std::vector<double> looErr;             // Leave-one-out errors, s
+  size_t failed;                          // Failed training solutions
+  size_t censored;                        // Censored training solutions
+  size_t fallbacks;                       // Queries answered by the solution
+
+  // Sampler of the training (shared by the workers)
+  std::mutex sampleMx;
+  size_t sampleInd, samplesN;
+  gsl_qrng *qrng;
+
+public:
+  explicit SurrogateModel(const HeatCase &c);
+  ~SurrogateModel();
+
+  SurrogateModel(const SurrogateModel&) = delete;
+  SurrogateModel& operator=(const SurrogateModel&) = delete;
+
+  void addParam(const CaseParam &cp);
+  void setThreads(size_t n);
+
+  void train(size_t n);
+  void save(const std::string &path) const;
+  void load(const std::string &path);
+
+  double predict(const std::vector<double> &p, double *err_est = nullptr) const;
+  double query(const std::vector<double> &p, double tol);
+
+  size_t size() const;
+  size_t getFailed() const;
+  size_t getCensored() const;
+  size_t getFallbacks() const;
+  double getLooRMS() const;
+
+private:
+  void worker();
+  double calcTime(const std::vector<double> &pv, bool &is_censored) const;
+  void scale(const std::vector<double> &p, std::vector<double> &x) const;
+  void fit();
+  static double phi(const std::vector<double> &x1,
+                    const std::vector<double> &x2);
+  static bool invert(std::vector<std::vector<double> > &M);
+};
+
+
+#endif // SURROGATE_H
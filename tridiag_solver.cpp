@@ -0,0 +1,243 @@
+#include "tridiag_solver.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <math.h>
+
+
+using namespace std;
+
+
+TridiagSolver* TridiagSolver::create(TridiagType type, size_t n)
+{
+  if (type == TRIDIAG_AUTO)
+    type = (n < tridiagCrossover()) ? TRIDIAG_THOMAS : TRIDIAG_CR;
+
+  if (type == TRIDIAG_CR)
+    return new CyclicReductionSolver();
+  return new ThomasSolver();
+}
+
+
+// *** Thomas ***
+void ThomasSolver::solve(const double *lo, double *di, const double *up,
+                         double *f, double *x, size_t n)
+{
+  for (size_t i = 1; i < n; ++i)
+  {
+    double w = lo[i] / di[i - 1];
+    di[i] -= w * up[i - 1];
+    f[i] -= w * f[i - 1];
+  }
+
+  x[n - 1] = f[n - 1] / di[n - 1];
+  for (size_t i = n - 1; i > 0; --i)
+    x[i - 1] = (f[i - 1] - up[i - 1] * x[i]) / di[i - 1];
+}
+// *** END OF Thomas ***
+
+
+// *** Cyclic reduction ***
+CyclicReductionSolver::CyclicReductionSolver(size_t threads) :
+  threadsN(threads), l(nullptr), u(nullptr), size(0)
+{
+  if (threadsN == 0)
+    threadsN = thread::hardware_concurrency();
+  if (threadsN == 0)
+    threadsN = 1;
+  pool.resize(threadsN);
+}
+
+
+CyclicReductionSolver::~CyclicReductionSolver()
+{
+  delete [] l;
+  delete [] u;
+}
+
+
+void CyclicReductionSolver::solve(const double *lo, double *di, const double *up,
+                                  double *f, double *x, size_t n)
+{
+  /*
+   * Level with stride s eliminates the neighbours i - s and i + s
+   * of the equations i = 2s - 1, 4s - 1, ... (forward reduction),
+   * then the unknowns i = s - 1, 3s - 1, ... are found from
+   * the already known i - s and i + s (back substitution).
+   * Every level is a loop of independent branch-free iterations.
+  */
+
+  if (n == 0)
+    throw err.sendEx("size of the system is 0");
+
+  if (size < n)
+  {
+    delete [] l;
+    delete [] u;
+    l = new double[n];
+    u = new double[n];
+    size = n;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    l[i] = lo[i];
+    u[i] = up[i];
+  }
+  l[0] = 0.0;
+  u[n - 1] = 0.0;
+
+  size_t s = 1;
+  for (; 2 * s <= n; s *= 2)
+    runLevel((n - 2 * s) / (2 * s) + 1,
+             [&](size_t k1, size_t k2) { reduceLevel(di, f, n, s, k1, k2); });
+
+  for (; s > 0; s /= 2)
+    runLevel((n - s) / (2 * s) + 1,
+             [&](size_t k1, size_t k2) { substLevel(di, f, x, n, s, k1, k2); });
+}
+
+
+void CyclicReductionSolver::reduceLevel(double *di, double *f, size_t n,
+                                        size_t s, size_t k1, size_t k2)
+{
+  for (size_t k = k1; k < k2; ++k)
+  {
+    size_t i = (2 * k + 2) * s - 1;
+    size_t im = i - s;
+    double al = -l[i] / di[im];
+    di[i] += al * u[im];
+    f[i] += al * f[im];
+    l[i] = al * l[im];
+
+    if (i + s < n)
+    {
+      size_t ip = i + s;
+      double ga = -u[i] / di[ip];
+      di[i] += ga * l[ip];
+      f[i] += ga * f[ip];
+      u[i] = ga * u[ip];
+    }
+    else
+      u[i] = 0.0;
+  }
+}
+
+
+void CyclicReductionSolver::substLevel(const double *di, const double *f,
+                                       double *x, size_t n,
+                                       size_t s, size_t k1, size_t k2)
+{
+  for (size_t k = k1; k < k2; ++k)
+  {
+    size_t i = (2 * k + 1) * s - 1;
+    double sum = f[i];
+    if (i >= s)
+      sum -= l[i] * x[i - s];
+    if (i + s < n)
+      sum -= u[i] * x[i + s];
+    x[i] = sum / di[i];
+  }
+}
+
+
+template <class Level>
+void CyclicReductionSolver::runLevel(size_t count, Level level)
+{
+  // Small levels aren't worth the threads' start
+  const size_t minChunk = 16384;
+
+  size_t tn = count / minChunk;
+  if (tn > threadsN)
+    tn = threadsN;
+  if (tn < 2)
+  {
+    level(0, count);
+    return;
+  }
+
+  size_t chunk = (count + tn - 1) / tn;
+  pool.run(tn, [&](size_t t)
+  {
+    size_t k1 = t * chunk;
+    size_t k2 = (k1 + chunk < count) ? k1 + chunk : count;
+    if (k1 < k2)
+      level(k1, k2);
+  });
+}
+// *** END OF Cyclic reduction ***
+
+
+size_t benchTridiagCrossover(ostream &os)
+{
+  /*
+   * Solves the diagonally dominant system typical for the implicit scheme
+   * by both algorithms for n = 2^10 ... TRIDIAG_BENCH_MAX_N.
+   * The crossover is the size from which CR is faster on two sizes in a row,
+   * larger sizes aren't measured then.
+  */
+
+  ThomasSolver thomas;
+  CyclicReductionSolver cr;
+
+  os << "n\tThomas, ms\tCR, ms\n";
+  size_t wins = 0;
+  for (size_t n = 1024; n <= TRIDIAG_BENCH_MAX_N; n *= 2)
+  {
+    vector<double> lo(n, -1.0), up(n, -1.0), x(n), di, f;
+    double t[2];
+    for (int alg = 0; alg < 2; ++alg)
+    {
+      TridiagSolver *ls = (alg == 0) ? static_cast<TridiagSolver*>(&thomas)
+                                     : static_cast<TridiagSolver*>(&cr);
+      int reps = int(TRIDIAG_BENCH_MAX_N / n) + 1;
+      chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+      for (int k = 0; k < reps; ++k)
+      {
+        di.assign(n, 2.5);
+        f.assign(n, 1.0);
+        ls->solve(lo.data(), di.data(), up.data(), f.data(), x.data(), n);
+      }
+      t[alg] = chrono::duration<double, milli>(
+                 chrono::steady_clock::now() - t0).count() / reps;
+    }
+    os << n << '\t' << t[0] << '\t' << t[1] << '\n';
+
+    wins = (t[1] < t[0]) ? wins + 1 : 0;
+    if (wins == 2)
+      return n / 2;
+  }
+
+  return 0;
+}
+
+
+static atomic<size_t> crossover(TRIDIAG_CROSSOVER);
+
+
+size_t tridiagCrossover()
+{
+  return crossover.load();
+}
+
+
+void setTridiagCrossover(size_t n)
+{
+  crossover.store(n);
+}
+
+
+size_t calibrateTridiagCrossover(ostream &os)
+{
+  /*
+   * Explicit (the first solve mustn't stall on it, nor every forked
+   * worker of a batch): call it once before the solutions.
+   * CR isn't chosen if it's never faster.
+  */
+
+  size_t n = benchTridiagCrossover(os);
+  setTridiagCrossover((n > 0) ? n : SIZE_MAX);
+  return tridiagCrossover();
+}
@@ -0,0 +1,82 @@
+#ifndef TRIDIAG_SOLVER_H
+#define TRIDIAG_SOLVER_H
+
+#include <cstddef>
+#include <ostream>
+
+#include "err.h"
+#include "worker_pool.h"
+
+#define TRIDIAG_BENCH_MAX_N 4194304   // Largest size of the crossover benchmark
+#define TRIDIAG_CROSSOVER 262144      // Default size to switch Thomas -> CR
+
+
+// Per-step linear solver of the tridiagonal system:
+// lo[i] * x[i - 1] + di[i] * x[i] + up[i] * x[i + 1] = f[i]
+enum TridiagType { TRIDIAG_THOMAS, TRIDIAG_CR, TRIDIAG_AUTO };
+
+
+class TridiagSolver
+{
+protected:
+  Error err;
+
+public:
+  virtual ~TridiagSolver() {}
+
+  // Arrays di and f may be used as work memory
+  virtual void solve(const double *lo, double *di, const double *up,
+                     double *f, double *x, size_t n) = 0;
+
+  static TridiagSolver* create(TridiagType type, size_t n);
+};
+
+
+// *** Thomas algorithm (sequential, O(n)) ***
+class ThomasSolver : public TridiagSolver
+{
+public:
+  void solve(const double *lo, double *di, const double *up,
+             double *f, double *x, size_t n);
+};
+
+
+// *** Cyclic reduction (log2(n) levels, each level is parallel) ***
+class CyclicReductionSolver : public TridiagSolver
+{
+private:
+  size_t threadsN;
+  WorkerPool pool;    // Threads of the levels
+  double *l, *u;      // Work copies of lo and up
+  size_t size;        // Size of work memory
+
+public:
+  explicit CyclicReductionSolver(size_t threads = 0);
+  ~CyclicReductionSolver();
+
+  void solve(const double *lo, double *di, const double *up,
+             double *f, double *x, size_t n);
+
+private:
+  void reduceLevel(double *di, double *f, size_t n, size_t s,
+                   size_t k1, size_t k2);
+  void substLevel(const double *di, const double *f, double *x, size_t n,
+                  size_t s, size_t k1, size_t k2);
+  template <class Level>
+  void runLevel(size_t count, Level level);
+};
+
+
+// Prints Thomas and CR timings and returns the crossover size (0 if none)
+size_t benchTridiagCrossover(std::ostream &os);
+
+// Size to switch Thomas -> CR for TRIDIAG_AUTO (TRIDIAG_CROSSOVER
+// unless it's set or calibrated; SIZE_MAX - CR isn't chosen)
+size_t tridiagCrossover();
+void setTridiagCrossover(size_t n);
+
+// Runs the benchmark (seconds) and sets its crossover, returns it
+size_t calibrateTridiagCrossover(std::ostream &os);
+
+
+#endif // TRIDIAG_SOLVER_H
@@ -142,6 +142,61 @@ void Wall::setGrid()
 }
 
 
+void Wall::setGrid(Grading g, double k, Face f)
+{
+  /*
+   * Build the non-uniform (graded) grid.
+   * GEOMETRIC: k is the ratio of neighbouring steps (k > 1);
+   * TANH: k is the clustering strength (k > 0).
+   * Nodes are concentrated toward the face f.
+  */
+
+  if (g == GEOMETRIC && k < 1.0)
+    throw err.sendEx("geometric ratio must be >= 1");
+  if (g == TANH && k < EPS)
+    throw err.sendEx("tanh clustering strength must be > 0");
+
+  if (g == UNIFORM || (g == GEOMETRIC && fabs(k - 1.0) < EPS))
+  {
+    setGrid();
+    return;
+  }
+
+  r = new double[N];
+  for (size_t i = 0; i < N; ++i)
+    r[i] = r1 + (r2 - r1) * gradeCoord(g, k, f, double(i) / (N - 1));
+  r[0] = r1;
+  r[N - 1] = r2;
+  is_grid = true;
+}
+
+
+double Wall::gradeCoord(Grading g, double k, Face f, double xi) const
+{
+  // Map the uniform coordinate xi in [0; 1] to the graded one
+
+  double m = double(N - 1);   // Number of segments to grade over
+
+  if (f == OUTER)
+    return 1.0 - gradeCoord(g, k, INNER, 1.0 - xi);
+  if (f == BOTH)
+  {
+    if (g == TANH)
+      return 0.5 * (1.0 + tanh(k * (2.0 * xi - 1.0)) / tanh(k));
+    // Each half has (N - 1) / 2 segments growing from its face
+    m *= 0.5;
+    if (xi <= 0.5)
+      return 0.5 * (pow(k, 2.0 * m * xi) - 1.0) / (pow(k, m) - 1.0);
+    return 1.0 - 0.5 * (pow(k, 2.0 * m * (1.0 - xi)) - 1.0) / (pow(k, m) - 1.0);
+  }
+
+  // Clustering toward the inner face
+  if (g == TANH)
+    return 1.0 + tanh(k * (xi - 1.0)) / tanh(k);
+  return (pow(k, m * xi) - 1.0) / (pow(k, m) - 1.0);
+}
+
+
 void Wall::setLambdaT(const string& file_path)
 {
   /*
@@ -243,24 +298,6 @@ void Wall::setSpecificHeat(double *c_, size_t n)
 // *** END OF Wall ***
 
 
-// *** Environment ***
-Environment::~Environment()
-{
-  if (dataSize != 0)
-  {
-    delete [] T;
-    delete [] lambda;
-    delete [] a;
-    delete [] c;
-    delete [] rho;
-    delete [] nu;
-    delete [] mu;
-    delete [] Pr;
-  }
-}
-// *** END OF Environment ***
-
-
 // *** Start conds ***
 void StartConds::setGeometry(const Walls &ws, double h)
 {
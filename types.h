@@ -21,9 +21,12 @@ struct Wall
 {
   Error err;
 
+  enum Grading { UNIFORM, GEOMETRIC, TANH };  // Grid stretching law
+  enum Face { INNER, OUTER, BOTH };           // Face to cluster nodes to
+
   size_t N;               // Number of spacing segments
   double r1, r2;          // Inner and outer radius of cylinder
-  double step;            // Space step
+  double step;            // Mean space step (exact for the uniform grid)
   double *T_table;        // Table temperature
   double *lambda;         // lambda(T) - wall's heat transfer coeff
   size_t dataSize;        // Size of lambda data
@@ -49,6 +52,7 @@ struct Wall
   Wall& operator=(const Wall &w);
 
   void setGrid();
+  void setGrid(Grading g, double k, Face f);
   void setLambdaT(const std::string& file_path);
   void setLambdaT(const double *T, const double *lam, size_t n);
   void setBlackness(double epsilon);
@@ -56,6 +60,9 @@ struct Wall
   void setSpecificHeat(double *c, size_t n);
 
   inline friend std::ostream& operator<<(std::ostream &os, const Wall &w);
+
+private:
+  double gradeCoord(Grading g, double k, Face f, double xi) const;
 };
 
 
@@ -106,58 +113,22 @@ typedef std::vector<Wall>::const_iterator WallCItr;
 // *** END OF Wall ***
 
 
-// *** Environment ***
-struct Environment
-{
-  double Ta;        // Ambient temperature
-  // Table data for future interpolation
-  size_t dataSize;
-  double *T;
-  double *lambda;
-  double *a;
-  double *c;
-  double *rho;
-  double *nu;
-  double *mu;
-  double *Pr;
-
-  Environment() : Ta(0.0), dataSize(0) {}
-  ~Environment();
-
-  inline friend std::ostream& operator<<(std::ostream &os,
-                                         const Environment &e);
-};
-
-
-std::ostream& operator<<(std::ostream &os, const Environment &e)
-{
-  os << "\t..... ENVIRONMENT .....\n";
-  os << "\tt, C\t\tlambda\t\trho\t\tcp\t\ta\t\tnu\t\tmu\t\tPr\n";
-  for (size_t i = 0; i < e.dataSize; ++i)
-    os << '\t' << e.T[i] - T_ABS
-       << "\t\t" << e.lambda[i]
-       << "\t\t" << e.rho[i]
-       << "\t\t" << e.c[i]
-       << "\t\t" << e.a[i]
-       << "\t\t" << e.nu[i]
-       << "\t\t" << e.mu[i]
-       << "\t\t" << e.Pr[i] << '\n';
-
-  os << '\n';
-  return os;
-}
-// *** END OF Environment ***
-
-
-// *** Boundary conditions (type 2) ***
+// *** Boundary conditions (types 1-3 and 4 - radiation only) ***
 struct BoundCond
 {
   int type;             // Type of boundary conditions:
+  double T_w;           // for type 1 (wall temperature)
   double q;             // for type 2 (heat flow to wall)
   double T_amb, alpha;  // for type 3 (ambient T and heat emission coeff)
+                        // and type 4 (ambient T)
 
-  BoundCond() : type(0), q(0.0), T_amb(0.0), alpha(0.0) {}
+  BoundCond() : type(0), T_w(0.0), q(0.0), T_amb(0.0), alpha(0.0) {}
 
+  void setType1(double t_w_C)
+  {
+    type = 1;
+    T_w = t_w_C + T_ABS;
+  }
   void setType2(double q)
   {
     type = 2;
@@ -169,6 +140,11 @@ struct BoundCond
     T_amb = t_amb_C + T_ABS;
     this->alpha = alpha;
   }
+  void setRadiation(double t_amb_C)
+  {
+    type = 4;
+    T_amb = t_amb_C + T_ABS;
+  }
 };
 // *** END OF boundary conditions ***
 
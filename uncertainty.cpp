@@ -0,0 +1,507 @@
+#include "uncertainty.h"
+
+#include <gsl/gsl_cdf.h>
+
+#include <algorithm>
+#include <thread>
+#include <math.h>
+
+
+using namespace std;
+
+
+// *** Streaming quantile ***
+StreamQuantile::StreamQuantile(double prob) : p(prob), count(0)
+{
+  for (int i = 0; i < 5; ++i)
+    n[i] = i + 1;
+  np[0] = 1.0;
+  np[1] = 1.0 + 2.0 * p;
+  np[2] = 1.0 + 4.0 * p;
+  np[3] = 3.0 + 2.0 * p;
+  np[4] = 5.0;
+  dn[0] = 0.0;
+  dn[1] = 0.5 * p;
+  dn[2] = p;
+  dn[3] = 0.5 * (1.0 + p);
+  dn[4] = 1.0;
+}
+
+
+void StreamQuantile::add(double x)
+{
+  // The first 5 observations are the initial markers
+
+  if (count < 5)
+  {
+    q[count++] = x;
+    if (count == 5)
+      sort(q, q + 5);
+    return;
+  }
+  count++;
+
+  // Cell of x (the extreme markers are moved if needed)
+  int k;
+  if (x < q[0])
+  {
+    q[0] = x;
+    k = 0;
+  }
+  else if (x >= q[4])
+  {
+    q[4] = x;
+    k = 3;
+  }
+  else
+  {
+    k = 0;
+    while (x >= q[k + 1])
+      k++;
+  }
+
+  for (int i = k + 1; i < 5; ++i)
+    n[i] += 1.0;
+  for (int i = 0; i < 5; ++i)
+    np[i] += dn[i];
+
+  // Adjustment of the middle markers
+  for (int i = 1; i < 4; ++i)
+  {
+    double d = np[i] - n[i];
+    if ((d >= 1.0 && n[i + 1] - n[i] > 1.0) ||
+        (d <= -1.0 && n[i - 1] - n[i] < -1.0))
+    {
+      double ds = (d > 0.0) ? 1.0 : -1.0;
+      double qp = parabolic(i, ds);
+      if (q[i - 1] < qp && qp < q[i + 1])
+        q[i] = qp;
+      else
+      {
+        int j = i + int(ds);
+        q[i] += ds * (q[j] - q[i]) / (n[j] - n[i]);
+      }
+      n[i] += ds;
+    }
+  }
+}
+
+
+double StreamQuantile::value() const
+{
+  if (count == 0)
+    return 0.0;
+  if (count < 5)
+  {
+    double s[5];
+    copy(q, q + count, s);
+    sort(s, s + count);
+    return s[size_t(p * (count - 1) + 0.5)];
+  }
+  return q[2];
+}
+
+
+double StreamQuantile::parabolic(int i, double d) const
+{
+  return q[i] + d / (n[i + 1] - n[i - 1])
+                * ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+                   + (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+// *** END OF Streaming quantile ***
+
+
+// *** Keyed permutation ***
+KeyedPermutation::KeyedPermutation(uint64_t size, uint64_t seed) : n(size)
+{
+  // Domain of the network is the least even power of 2 >= n
+
+  halfBits = 1;
+  while (halfBits < 32 && (uint64_t(1) << (2 * halfBits)) < n)
+    halfBits++;
+  mask = (uint64_t(1) << halfBits) - 1;
+
+  mt19937_64 gen(seed);
+  for (int k = 0; k < 4; ++k)
+    keys[k] = gen();
+}
+
+
+uint64_t KeyedPermutation::operator()(uint64_t i) const
+{
+  /*
+   * Feistel network is a bijection of [0; 4^halfBits); the values
+   * out of [0; n) are walked through the cycle (< 4 passes on average),
+   * so the restriction to [0; n) is a bijection too.
+  */
+
+  uint64_t x = i;
+  do
+  {
+    uint64_t l = x >> halfBits;
+    uint64_t r = x & mask;
+    for (int k = 0; k < 4; ++k)
+    {
+      uint64_t t = l ^ round(r, keys[k]);
+      l = r;
+      r = t;
+    }
+    x = (l << halfBits) | r;
+  } while (x >= n);
+  return x;
+}
+
+
+uint64_t KeyedPermutation::round(uint64_t x, uint64_t key) const
+{
+  // splitmix64 finalizer of the keyed half
+  uint64_t z = x ^ key;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return (z ^ (z >> 31)) & mask;
+}
+// *** END OF Keyed permutation ***
+
+
+// *** Uncertainty propagation ***
+double UncertainParam::value(double u) const
+{
+  // Ends of (0; 1) are cut for the unbounded distributions
+
+  u = std::max(1e-12, std::min(1.0 - 1e-12, u));
+  if (dist == DIST_NORMAL)
+    return a + gsl_cdf_gaussian_Pinv(u, b);
+  return a + (b - a) * u;
+}
+
+
+UncertaintyAnalyzer::UncertaintyAnalyzer(const HeatCase &c) :
+  hc(c), sampling(SAMPLING_LHS), is_sobol(true), threadsN(0), seed(1),
+  sampleInd(0), samplesN(0), qrng(nullptr),
+  count(0), failed(0), censored(0), sobolN(0), mean(0.0), m2(0.0), tMin(0.0), tMax(0.0)
+{
+  probs.push_back(0.05);
+  probs.push_back(0.5);
+  probs.push_back(0.95);
+}
+
+
+UncertaintyAnalyzer::~UncertaintyAnalyzer()
+{
+  if (qrng)
+    gsl_qrng_free(qrng);
+}
+
+
+void UncertaintyAnalyzer::addParam(const CaseParam &cp, Distribution d,
+                                   double a, double b)
+{
+  if (d == DIST_UNIFORM && b <= a)
+    throw err.sendEx("bounds of the uniform distribution are wrong");
+  if (d == DIST_NORMAL && b <= 0.0)
+    throw err.sendEx("standard deviation must be > 0");
+  cp.get(hc);   // Checks the parameter
+  params.push_back(UncertainParam(cp, d, a, b));
+}
+
+
+void UncertaintyAnalyzer::setSampling(Sampling s, unsigned rng_seed)
+{
+  sampling = s;
+  seed = rng_seed;
+}
+
+
+void UncertaintyAnalyzer::setSobol(bool on)
+{
+  is_sobol = on;
+}
+
+
+void UncertaintyAnalyzer::setThreads(size_t n)
+{
+  // 0 - all the cores
+  threadsN = n;
+}
+
+
+void UncertaintyAnalyzer::setPercentiles(const vector<double> &p)
+{
+  for (size_t i = 0; i < p.size(); ++i)
+    if (p[i] <= 0.0 || p[i] >= 1.0)
+      throw err.sendEx("probability of the percentile must be in (0; 1)");
+  probs = p;
+}
+
+
+void UncertaintyAnalyzer::run(size_t n)
+{
+  /*
+   * n base samples: n solutions without the Sobol indices,
+   * n * (d + 2) with them (d - number of the parameters).
+  */
+
+  if (params.empty())
+    throw err.sendEx("uncertain parameters are not set");
+  if (n == 0)
+    throw err.sendEx("number of samples is 0");
+
+  count = failed = censored = sobolN = 0;
+  mean = m2 = 0.0;
+  quant.clear();
+  for (size_t k = 0; k < probs.size(); ++k)
+    quant.push_back(StreamQuantile(probs[k]));
+  sumS.assign(params.size(), 0.0);
+  sumST.assign(params.size(), 0.0);
+
+  prepareSampler(n);
+
+  size_t tn = threadsN;
+  if (tn == 0)
+    tn = thread::hardware_concurrency();
+  if (tn == 0)
+    tn = 1;
+  if (tn > n)
+    tn = n;
+
+  vector<thread> pool;
+  for (size_t t = 0; t < tn; ++t)
+    pool.push_back(thread(&UncertaintyAnalyzer::worker, this));
+  for (size_t t = 0; t < pool.size(); ++t)
+    pool[t].join();
+}
+
+
+void UncertaintyAnalyzer::prepareSampler(size_t n)
+{
+  size_t dims = is_sobol ? 2 * params.size() : params.size();
+
+  sampleInd = 0;
+  samplesN = n;
+  rng.seed(seed);
+  lhsPerm.clear();
+  if (qrng)
+  {
+    gsl_qrng_free(qrng);
+    qrng = nullptr;
+  }
+
+  if (sampling == SAMPLING_SOBOL)
+  {
+    if (dims > 40)
+      throw err.sendEx("too many parameters for the Sobol sequence");
+    qrng = gsl_qrng_alloc(gsl_qrng_sobol, dims);
+    return;
+  }
+
+  // Latin hypercube: a random stratum of each dimension for every sample
+  for (size_t k = 0; k < dims; ++k)
+    lhsPerm.push_back(KeyedPermutation(n, rng()));
+}
+
+
+bool UncertaintyAnalyzer::nextSample(vector<double> &u)
+{
+  lock_guard<mutex> lock(sampleMx);
+  if (sampleInd == samplesN)
+    return false;
+
+  if (qrng)
+    gsl_qrng_get(qrng, u.data());
+  else
+  {
+    uniform_real_distribution<double> ud(0.0, 1.0);
+    for (size_t k = 0; k < u.size(); ++k)
+      u[k] = (lhsPerm[k](sampleInd) + ud(rng)) / samplesN;
+  }
+  sampleInd++;
+  return true;
+}
+
+
+void UncertaintyAnalyzer::worker()
+{
+  // A sample of A and B with all the A_B^i is solved by one worker
+
+  ImplicitDiffSchemeCyl solver;   // Reused by all the samples of the worker
+  size_t d = params.size();
+  vector<double> u(is_sobol ? 2 * d : d);
+  vector<double> uA(d), uB(d), uAB(d), fAB(d);
+
+  while (nextSample(u))
+  {
+    try
+    {
+      // A sample with a censored solution is left out of the statistics
+      bool is_cens;
+      size_t cens = 0;
+      uA.assign(u.begin(), u.begin() + d);
+      double fA = calcTime(uA, solver, is_cens);
+      cens += is_cens;
+      if (!is_sobol)
+      {
+        lock_guard<mutex> lock(statMx);
+        if (cens == 0)
+          addValue(fA);
+        else
+          censored++;
+        continue;
+      }
+
+      uB.assign(u.begin() + d, u.end());
+      double fB = calcTime(uB, solver, is_cens);
+      cens += is_cens;
+      for (size_t i = 0; i < d; ++i)
+      {
+        uAB = uA;
+        uAB[i] = uB[i];
+        fAB[i] = calcTime(uAB, solver, is_cens);
+        cens += is_cens;
+      }
+      if (cens == 0)
+        addResult(fA, fB, fAB);
+      else
+      {
+        lock_guard<mutex> lock(statMx);
+        censored++;
+      }
+    }
+    catch (const string &)
+    {
+      lock_guard<mutex> lock(statMx);
+      failed++;
+    }
+  }
+}
+
+
+double UncertaintyAnalyzer::calcTime(const vector<double> &u,
+                                     ImplicitDiffSchemeCyl &solver,
+                                     bool &is_censored) const
+{
+  HeatCase c = hc;
+  for (size_t i = 0; i < params.size(); ++i)
+    params[i].param.set(c, params[i].value(u[i]));
+
+  vector<double> t, Tw_C;
+  c.solve(t, Tw_C, solver);
+  is_censored = Tw_C.empty() || Tw_C.back() > c.Ta_C + c.delta_T;
+  return c.thresholdTime(t, Tw_C);
+}
+
+
+void UncertaintyAnalyzer::addResult(double fA, double fB, const vector<double> &fAB)
+{
+  lock_guard<mutex> lock(statMx);
+
+  addValue(fA);
+  addValue(fB);
+  for (size_t i = 0; i < fAB.size(); ++i)
+  {
+    sumS[i] += fB * (fAB[i] - fA);
+    sumST[i] += (fA - fAB[i]) * (fA - fAB[i]);
+  }
+  sobolN++;
+}
+
+
+void UncertaintyAnalyzer::addValue(double f)
+{
+  count++;
+  double delta = f - mean;
+  mean += delta / count;
+  m2 += delta * (f - mean);
+
+  if (count == 1 || f < tMin)
+    tMin = f;
+  if (count == 1 || f > tMax)
+    tMax = f;
+
+  for (size_t k = 0; k < quant.size(); ++k)
+    quant[k].add(f);
+}
+
+
+size_t UncertaintyAnalyzer::getCount() const
+{
+  return count;
+}
+
+
+size_t UncertaintyAnalyzer::getFailed() const
+{
+  return failed;
+}
+
+
+size_t UncertaintyAnalyzer::getCensored() const
+{
+  // Samples with a solution that didn't reach the threshold by t_max
+  return censored;
+}
+
+
+double UncertaintyAnalyzer::getMean() const
+{
+  return mean;
+}
+
+
+double UncertaintyAnalyzer::getStd() const
+{
+  return (count > 1) ? sqrt(m2 / (count - 1)) : 0.0;
+}
+
+
+double UncertaintyAnalyzer::getPercentile(size_t k) const
+{
+  if (k >= quant.size())
+    throw err.sendEx("no such percentile");
+  return quant[k].value();
+}
+
+
+double UncertaintyAnalyzer::getSobolFirst(size_t i) const
+{
+  if (i >= sumS.size())
+    throw err.sendEx("no such parameter");
+  double var = (count > 1) ? m2 / (count - 1) : 0.0;
+  if (sobolN == 0 || var < EPS)
+    return 0.0;
+  return sumS[i] / sobolN / var;
+}
+
+
+double UncertaintyAnalyzer::getSobolTotal(size_t i) const
+{
+  if (i >= sumST.size())
+    throw err.sendEx("no such parameter");
+  double var = (count > 1) ? m2 / (count - 1) : 0.0;
+  if (sobolN == 0 || var < EPS)
+    return 0.0;
+  return 0.5 * sumST[i] / sobolN / var;
+}
+
+
+void UncertaintyAnalyzer::writeReport(ostream &os) const
+{
+  os << "\t..... TIME-TO-THRESHOLD UNCERTAINTY .....\n"
+     << "\tsamples: " << count << " (failed: " << failed
+     << ", censored: " << censored << ")\n"
+     << "\tmean, s: " << getMean() << '\n'
+     << "\tstd, s: " << getStd() << '\n'
+     << "\tmin, s: " << tMin << '\n'
+     << "\tmax, s: " << tMax << '\n';
+  for (size_t k = 0; k < quant.size(); ++k)
+    os << "\tP" << probs[k] * 100.0 << ", s: " << quant[k].value() << '\n';
+
+  if (sobolN > 0)
+  {
+    os << "\tparameter\tS\tST\n";
+    for (size_t i = 0; i < params.size(); ++i)
+      os << "\t#" << i + 1 << ".\t"
+         << getSobolFirst(i) << '\t' << getSobolTotal(i) << '\n';
+  }
+  os << '\n';
+}
+// *** END OF Uncertainty propagation ***
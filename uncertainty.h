@@ -0,0 +1,156 @@
+#ifndef UNCERTAINTY_H
+#define UNCERTAINTY_H
+
+#include <gsl/gsl_qrng.h>
+
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+#include "err.h"
+#include "heat_case.h"
+
+
+// *** Streaming quantile (P^2 algorithm, 5 markers, no samples stored) ***
+class StreamQuantile
+{
+private:
+  double p;         // Probability of the quantile
+  size_t count;
+  double q[5];      // Markers' heights
+  double n[5];      // Markers' positions
+  double np[5];     // Desired positions
+  double dn[5];     // Increments of the desired positions
+
+public:
+  explicit StreamQuantile(double prob);
+
+  void add(double x);
+  double value() const;
+
+private:
+  double parabolic(int i, double d) const;
+};
+// *** END OF Streaming quantile ***
+
+
+// *** Keyed permutation of [0; n) (nothing is stored per element) ***
+class KeyedPermutation
+{
+private:
+  uint64_t n;
+  unsigned halfBits;    // Feistel network over 2 * halfBits bits
+  uint64_t mask;        // Mask of the half
+  uint64_t keys[4];     // Round keys
+
+public:
+  KeyedPermutation(uint64_t size = 1, uint64_t seed = 0);
+
+  uint64_t operator()(uint64_t i) const;
+
+private:
+  uint64_t round(uint64_t x, uint64_t key) const;
+};
+// *** END OF Keyed permutation ***
+
+
+// *** Uncertainty propagation ***
+enum Distribution
+{
+  DIST_UNIFORM,     // a, b - bounds
+  DIST_NORMAL       // a - mean, b - standard deviation
+};
+
+
+struct UncertainParam
+{
+  CaseParam param;
+  Distribution dist;
+  double a, b;
+
+  UncertainParam(const CaseParam &cp, Distribution d, double a_, double b_) :
+    param(cp), dist(d), a(a_), b(b_) {}
+
+  double value(double u) const;   // Value of the quantile u in (0; 1)
+};
+
+
+/*
+ * Propagation of the parameters' uncertainty to the time-to-threshold
+ * (the time Tw falls to Ta + delta_T) by sampling.
+ * Samples are solved on all the cores and aggregated on the fly:
+ * mean, variance, percentiles (P^2) and the Sobol indices
+ * (Saltelli's A, B, A_B^i design with Jansen's estimators),
+ * so memory doesn't depend on the number of samples (the LHS strata
+ * are keyed permutations). The censored samples (the threshold isn't
+ * reached by t_max) are counted apart and excluded from the statistics.
+*/
+class UncertaintyAnalyzer
+{
+public:
+  enum Sampling { SAMPLING_LHS, SAMPLING_SOBOL };
+
+private:
+  mutable Error err;
+
+  HeatCase hc;
+  std::vector<UncertainParam> params;
+  Sampling sampling;
+  bool is_sobol;                  // Are the Sobol indices estimated
+  size_t threadsN;
+  unsigned seed;
+
+  // Sampler (shared by the workers)
+  std::mutex sampleMx;
+  size_t sampleInd, samplesN;
+  std::mt19937_64 rng;
+  std::vector<KeyedPermutation> lhsPerm;  // Strata of each dimension
+  gsl_qrng *qrng;
+
+  // Statistics
+  std::mutex statMx;
+  std::vector<double> probs;
+  std::vector<StreamQuantile> quant;
+  size_t count, failed, censored, sobolN;
+  double mean, m2;                // Welford's accumulators
+  double tMin, tMax;
+  std::vector<double> sumS;       // Sum of fB * (fAB_i - fA)
+  std::vector<double> sumST;      // Sum of (fA - fAB_i)^2
+
+public:
+  explicit UncertaintyAnalyzer(const HeatCase &c);
+  ~UncertaintyAnalyzer();
+
+  void addParam(const CaseParam &cp, Distribution d, double a, double b);
+  void setSampling(Sampling s, unsigned rng_seed = 1);
+  void setSobol(bool on);
+  void setThreads(size_t n);
+  void setPercentiles(const std::vector<double> &p);
+
+  void run(size_t n);
+
+  size_t getCount() const;
+  size_t getFailed() const;
+  size_t getCensored() const;
+  double getMean() const;
+  double getStd() const;
+  double getPercentile(size_t k) const;
+  double getSobolFirst(size_t i) const;
+  double getSobolTotal(size_t i) const;
+  void writeReport(std::ostream &os) const;
+
+private:
+  void prepareSampler(size_t n);
+  bool nextSample(std::vector<double> &u);
+  void worker();
+  double calcTime(const std::vector<double> &u, ImplicitDiffSchemeCyl &solver,
+                  bool &is_censored) const;
+  void addResult(double fA, double fB, const std::vector<double> &fAB);
+  void addValue(double f);
+};
+// *** END OF Uncertainty propagation ***
+
+
+#endif // UNCERTAINTY_H
@@ -0,0 +1,145 @@
+#include "worker_pool.h"
+
+
+using namespace std;
+
+
+WorkerPool::WorkerPool(size_t n) :
+  gen(0), is_stop(false), task(nullptr), taskN(0), next(0), busy(0)
+{
+  resize(n);
+}
+
+
+WorkerPool::~WorkerPool()
+{
+  stop();
+}
+
+
+void WorkerPool::resize(size_t n)
+{
+  // n - threads of a section including the caller's one (0 - all the cores)
+
+  if (n == 0)
+    n = thread::hardware_concurrency();
+  if (n == 0)
+    n = 1;
+  if (n == size())
+    return;
+  stop();
+  start(n);
+}
+
+
+size_t WorkerPool::size() const
+{
+  return threads.size() + 1;
+}
+
+
+void WorkerPool::run(size_t n, const function<void(size_t)> &f)
+{
+  // Not reentrant: a task mustn't run a section of the same pool
+
+  if (threads.empty() || n < 2)
+  {
+    for (size_t k = 0; k < n; ++k)
+      f(k);
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(mx);
+    task = &f;
+    taskN = n;
+    next.store(0);
+    busy = threads.size();
+    taskErr.clear();
+    gen.fetch_add(1);
+  }
+  cvStart.notify_all();
+
+  work();
+
+  unique_lock<mutex> lock(mx);
+  cvDone.wait(lock, [this] { return busy == 0; });
+  task = nullptr;
+  if (!taskErr.empty())
+    throw taskErr;
+}
+
+
+// *** PRIVATE ***
+void WorkerPool::start(size_t n)
+{
+  is_stop = false;
+  for (size_t t = 1; t < n; ++t)
+    threads.push_back(thread(&WorkerPool::loop, this, gen.load()));
+}
+
+
+void WorkerPool::stop()
+{
+  {
+    lock_guard<mutex> lock(mx);
+    is_stop = true;
+  }
+  cvStart.notify_all();
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  threads.clear();
+}
+
+
+void WorkerPool::loop(size_t seen)
+{
+  // seen - the last section before the start (a section may come first)
+
+  while (true)
+  {
+    // Sections of a time step follow closely: poll before sleeping
+    for (int s = 0; s < POOL_SPIN && gen.load() == seen; ++s)
+      this_thread::yield();
+
+    {
+      unique_lock<mutex> lock(mx);
+      cvStart.wait(lock, [this, seen] { return is_stop || gen.load() != seen; });
+      if (is_stop)
+        return;
+      seen = gen.load();
+    }
+
+    work();
+
+    lock_guard<mutex> lock(mx);
+    if (--busy == 0)
+      cvDone.notify_one();
+  }
+}
+
+
+void WorkerPool::work()
+{
+  // Tasks are taken one by one, so the faster threads take more of them
+
+  for (size_t k = next.fetch_add(1); k < taskN; k = next.fetch_add(1))
+  {
+    try
+    {
+      (*task)(k);
+    }
+    catch (const string &e)
+    {
+      lock_guard<mutex> lock(mx);
+      if (taskErr.empty())
+        taskErr = e;
+    }
+    catch (...)
+    {
+      lock_guard<mutex> lock(mx);
+      if (taskErr.empty())
+        taskErr = err.sendEx("task of the worker pool failed");
+    }
+  }
+}
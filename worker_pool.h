@@ -0,0 +1,63 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "err.h"
+
+#define POOL_SPIN 2000    // Polls of a waiting worker before it sleeps
+
+
+/*
+ * Persistent threads for the parallel sections of a time step.
+ * run(n, task) calls task(0) ... task(n - 1) on the pool's threads and
+ * the caller's one and returns when all the tasks are done (barrier).
+ * The threads are created once, so a section costs their wake-up only:
+ * a waiting worker polls the next section for a while before it sleeps.
+*/
+class WorkerPool
+{
+private:
+  Error err;
+
+  std::vector<std::thread> threads;       // Helpers of the caller's thread
+  std::mutex mx;
+  std::condition_variable cvStart, cvDone;
+  std::atomic<size_t> gen;                // Index of the current section
+  bool is_stop;
+
+  // Current section
+  const std::function<void(size_t)> *task;
+  size_t taskN;
+  std::atomic<size_t> next;               // Next task to take
+  size_t busy;                            // Helpers still in the section
+  std::string taskErr;                    // First exception of the tasks
+
+public:
+  explicit WorkerPool(size_t n = 1);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void resize(size_t n);
+  size_t size() const;
+
+  void run(size_t n, const std::function<void(size_t)> &f);
+
+private:
+  void start(size_t n);
+  void stop();
+  void loop(size_t seen);
+  void work();
+};
+
+
+#endif // WORKER_POOL_H